@@ -32,8 +32,14 @@ MODULE_SRC_FILES += \
     src/JavaBinding.cpp \
     src/JavaNI.cpp \
     src/JavaArray.cpp \
+    src/JavaAlgorithms.cpp \
     src/JavaLang.cpp \
+    src/JavaNio.cpp \
     src/JavaObject.cpp \
+    src/JavaPacked.cpp \
+    src/UTFConverter.cpp \
+    src/BoolConverter.cpp \
+    src/ElementConverter.cpp \
     
 MODULE_LDLIBS := -llog
 
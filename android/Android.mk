@@ -35,8 +35,14 @@ LOCAL_SRC_FILES := \
     $(ITOA_JNIPP_ROOT)/src/JavaBinding.cpp \
     $(ITOA_JNIPP_ROOT)/src/JavaNI.cpp \
     $(ITOA_JNIPP_ROOT)/src/JavaArray.cpp \
+    $(ITOA_JNIPP_ROOT)/src/JavaAlgorithms.cpp \
     $(ITOA_JNIPP_ROOT)/src/JavaLang.cpp \
+    $(ITOA_JNIPP_ROOT)/src/JavaNio.cpp \
     $(ITOA_JNIPP_ROOT)/src/JavaObject.cpp \
+    $(ITOA_JNIPP_ROOT)/src/JavaPacked.cpp \
+    $(ITOA_JNIPP_ROOT)/src/UTFConverter.cpp \
+    $(ITOA_JNIPP_ROOT)/src/BoolConverter.cpp \
+    $(ITOA_JNIPP_ROOT)/src/ElementConverter.cpp \
 
 LOCAL_STATIC_LIBRARIES := itoa-dropins
 
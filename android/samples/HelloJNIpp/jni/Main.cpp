@@ -25,10 +25,10 @@ typedef java::ObjectPointer<MyCustomView> PMyCustomView;
 
 class MyCustomView: public LiveView {
 public:
-    static bool SetNativeInstance(const char* tag,const jni::LObject&);
     color_t GetFillColor() const;
     void SetFillColor(color_t color);
 private:
+    friend class jb::NativeFactory<MyCustomView>;
     MyCustomView(const jni::LObject&);
     virtual void Construct(PContext context,PAttributeSet attrs);
     virtual void OnDraw(PCanvas canvas);
@@ -37,14 +37,6 @@ private:
 };
 
 
-bool MyCustomView::SetNativeInstance(const char* tag,const jni::LObject& object) {
-    if (strcmp(tag,"MyCustomView")) {
-        return false;
-    }
-    new MyCustomView(object);
-    return true;
-}
-
 MyCustomView::MyCustomView(const jni::LObject& object):
     LiveView(object),
     m_fillColor(Color::LTGRAY)
@@ -73,24 +65,13 @@ void MyCustomView::SetFillColor(color_t color) {
 
 class MainActivity: public Activity {
 public:
-    static bool SetNativeInstance(const char* className,const jni::LObject& object);
     virtual void OnCreate(const jni::LObject& state);
 private:
+    friend class jb::NativeFactory<MainActivity>;
     MainActivity(const jni::LObject& object);
     void ChangeColor(PView view);
 };
 
-bool MainActivity::SetNativeInstance(const char* className,const jni::LObject& object) {
-    if (strcmp(className,"com.itoa.jnipp.hello.MainActivity")) {
-        return false;
-    }
-    new MainActivity(object);
-    // There is no leak since java class has a reference to
-    //  the native instance. Destructor will be called
-    //  when finalizer is run on java class.
-    return true;
-}
-
 MainActivity::MainActivity(const jni::LObject& object):
     Activity(object)
 {
@@ -111,13 +92,6 @@ void MainActivity::ChangeColor(PView) {
     view->SetFillColor(0xFF000000 | (view->GetFillColor()*87443));
 }
 
-///////////////////////////////////////////////////////////////////// SetNativeInstance
-
-void SetNativeInstance(const char* tag,const jni::LObject& object) {
-    MainActivity::SetNativeInstance(tag,object) ||
-    MyCustomView::SetNativeInstance(tag,object);
-}
-
 ///////////////////////////////////////////////////////////////////// JNI_OnLoad
 
 extern "C" jint JNI_OnLoad(JavaVM* vm,void* reserved) {
@@ -125,6 +99,14 @@ extern "C" jint JNI_OnLoad(JavaVM* vm,void* reserved) {
     Activity::RegisterCallbacks();
     LiveView::RegisterCallbacks();
     R::Initialize(APP_PACKAGE);
+
+    // Native instances are created by Activity and LiveView for
+    //  these names. There is no leak since java class has a reference
+    //  to the native instance. Destructor will be called when
+    //  finalizer is run on java class.
+    jb::RegisterNativeFactory<MainActivity>("com.itoa.jnipp.hello.MainActivity");
+    jb::RegisterNativeFactory<MyCustomView>("MyCustomView");
+
     return JNI_VERSION_1_6;
 }
 
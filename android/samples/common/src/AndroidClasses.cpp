@@ -15,6 +15,7 @@
  */
 
 #include "AndroidClasses.h"
+#include "../../../../src/StringHashTable.h"
 #include <string>
 
 #include <android/log.h>
@@ -50,10 +51,171 @@ void Log::Debug(const char* tag,const char* message,...) {
 }
 ///////////////////////////////////////////////////////////////////// R
 
+/////////////////////////////////////// reflection
+
+#define JB_CURRENT_CLASS ReflectedClass
+
+JB_DEFINE_ACCESSOR(
+    "java/lang/Class"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        GetFields,
+        "getFields",
+        "()[Ljava/lang/reflect/Field;"
+    )
+)
+
+static jni::LObject GetClassFields(const java::Class& clazz) {
+    return JB_CALL(ObjectMethod,clazz,GetFields);
+}
+
+#undef JB_CURRENT_CLASS
+
+#define JB_CURRENT_CLASS ReflectedField
+
+JB_DEFINE_ACCESSOR(
+    "java/lang/reflect/Field"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        GetName,
+        "getName",
+        "()Ljava/lang/String;"
+    )
+    (
+        GetType,
+        "getType",
+        "()Ljava/lang/Class;"
+    )
+    (
+        GetModifiers,
+        "getModifiers",
+        "()I"
+    )
+    (
+        GetInt,
+        "getInt",
+        "(Ljava/lang/Object;)I"
+    )
+)
+
+/* Value of java.lang.reflect.Modifier.STATIC. */
+static const jint StaticModifier=0x0008;
+
+/* Returns true if field is static and has type 'int'.
+ */
+static bool IsStaticIntField(const jni::AbstractObject& field,const jni::AbstractObject& intClass) {
+    jint modifiers=JB_CALL(IntMethod,field,GetModifiers);
+    return (modifiers & StaticModifier) &&
+        jni::IsSameObject(JB_CALL(ObjectMethod,field,GetType),intClass);
+}
+
+static java::PString GetFieldName(const jni::AbstractObject& field) {
+    return java::PString::Wrap(JB_CALL(ObjectMethod,field,GetName));
+}
+
+static jint GetStaticIntFieldValue(const jni::AbstractObject& field) {
+    return JB_CALL(IntMethod,field,GetInt,jni::LObject());
+}
+
+#undef JB_CURRENT_CLASS
+
+#define JB_CURRENT_CLASS ReflectedInteger
+
+JB_DEFINE_ACCESSOR(
+    "java/lang/Integer"
+    ,
+    Fields
+    (
+        Type,
+        "=TYPE",
+        "Ljava/lang/Class;"
+    )
+    ,
+    NoMethods
+)
+
+static jni::LObject GetIntClass() {
+    return JB_GET_STATIC(ObjectField,Type);
+}
+
+#undef JB_CURRENT_CLASS
+
+/////////////////////////////////////// ValueCache
+
+/* Hash map from value names to values. Lookups take read lock,
+ *  so they don't block each other.
+ */
+class R::ValueCache {
+public:
+    explicit ValueCache(const char* className):
+        m_className(className),
+        m_class(0)
+    {
+        pthread_rwlock_init(&m_lock,0);
+    }
+
+    ~ValueCache() {
+        pthread_rwlock_destroy(&m_lock);
+    }
+
+    const char* GetClassName() const {
+        return m_className;
+    }
+
+    /* Inner class, guarded by R::m_lock. */
+    java::Class*& GetClassReference() {
+        return m_class;
+    }
+
+    bool Find(const char* name,int32_t& value) {
+        pthread_rwlock_rdlock(&m_lock);
+        const int32_t* entry=m_values.Find(name);
+        if (entry) {
+            value=*entry;
+        }
+        pthread_rwlock_unlock(&m_lock);
+        return entry!=0;
+    }
+
+    void Add(const char* name,int32_t value) {
+        pthread_rwlock_wrlock(&m_lock);
+        m_values.Insert(name)=value;
+        pthread_rwlock_unlock(&m_lock);
+    }
+
+    void Clear() {
+        pthread_rwlock_wrlock(&m_lock);
+        m_values.Clear();
+        pthread_rwlock_unlock(&m_lock);
+        if (m_class) {
+            m_class->Release();
+            m_class=0;
+        }
+    }
+
+private:
+    ValueCache(const ValueCache&);
+    ValueCache& operator=(const ValueCache&);
+
+private:
+    const char* m_className;
+    java::Class* m_class;
+    pthread_rwlock_t m_lock;
+    jb::StringHashTable<int32_t> m_values;
+};
+
+/////////////////////////////////////// R
+
 char* R::m_packageName=0;
 pthreadpp::mutex R::m_lock(pthreadpp::mutex::initializer());
-java::Class* R::m_idClass=0;
-java::Class* R::m_layoutClass=0;
+R::ValueCache R::m_ids("id");
+R::ValueCache R::m_layouts("layout");
 
 void R::Initialize(const char* packageName) {
     pthreadpp::mutex_guard guard(m_lock);
@@ -66,45 +228,73 @@ void R::Destroy() {
     DestroyNoLock();
 }
 
+void R::Preload() {
+    PreloadCache(m_ids);
+    PreloadCache(m_layouts);
+}
+
+int32_t R::GetID(const char* valueName) {
+    return GetValue(m_ids,valueName);
+}
+
+int32_t R::GetLayout(const char* valueName) {
+    return GetValue(m_layouts,valueName);
+}
+
 void R::DestroyNoLock() {
     if (m_packageName) {
         free(m_packageName);
         m_packageName=0;
     }
-    DestroyInnerClass(m_idClass);
-    DestroyInnerClass(m_layoutClass);
+    m_ids.Clear();
+    m_layouts.Clear();
 }
 
-void R::InitInnerClass(java::Class*& clazz,const char* className) {
+java::PClass R::GetInnerClass(ValueCache& cache) {
     pthreadpp::mutex_guard guard(m_lock);
+    java::Class*& clazz=cache.GetClassReference();
     if (!clazz) {
         std::string fullName;
         fullName+=m_packageName;
         fullName+=".R$";
-        fullName+=className;
+        fullName+=cache.GetClassName();
         clazz=java::Class::ForName(fullName.c_str()).Detach();
     }
-}
-
-void R::DestroyInnerClass(java::Class*& clazz) {
-    if (clazz) {
-        clazz->Release();
-        clazz=0;
+    return clazz;
+}
+
+void R::PreloadCache(ValueCache& cache) {
+    java::PClass clazz=GetInnerClass(cache);
+    jni::LObject intClass=GetIntClass();
+    jni::LObject fields=GetClassFields(*clazz);
+    java::ObjectArrayReader reader(fields);
+    while (reader.Next()) {
+        const jni::AbstractObject& field=reader.Get();
+        if (IsStaticIntField(field,intClass)) {
+            cache.Add(
+                GetFieldName(field)->GetUTF(),
+                GetStaticIntFieldValue(field));
+        }
     }
 }
 
-int32_t R::GetInnerClassInt(java::Class*& clazz,const char* className,const char* valueName) {
-    InitInnerClass(clazz,className);
-    jfieldID fieldID=jni::GetStaticFieldID(*clazz,valueName,"I");
-    return jni::GetStaticIntField(*clazz,fieldID);
+int32_t R::GetValue(ValueCache& cache,const char* valueName) {
+    int32_t value;
+    if (!cache.Find(valueName,value)) {
+        java::PClass clazz=GetInnerClass(cache);
+        jfieldID fieldID=jni::GetStaticFieldID(*clazz,valueName,"I");
+        value=jni::GetStaticIntField(*clazz,fieldID);
+        cache.Add(valueName,value);
+    }
+    return value;
 }
 
-int32_t R::GetID(const char* valueName) {
-    return GetInnerClassInt(m_idClass,"id",valueName);
-}
+///////////////////////////////////////////////////////////////////// SetNativeInstance
 
-int32_t R::GetLayout(const char* valueName) {
-    return GetInnerClassInt(m_layoutClass,"layout",valueName);
+void SetNativeInstance(const char* tag,const jni::LObject& object) {
+    if (!jb::CreateNativeInstance(tag,object)) {
+        jni::FatalError("No native factory is registered for '%s'.",tag);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////// Window
@@ -36,7 +36,9 @@ public:
 ///////////////////////////////////////////////////////////////////// R
 
 /** Accessor for R class.
- * Values are queried in runtime by their names.
+ * Values are queried in runtime by their names and cached, so
+ *  that repeated queries don't call Java. Preload() reads all
+ *  values at once.
  *
  * Note that class must be initialized with package name, see
  *  \c Initialize() method.
@@ -45,18 +47,25 @@ class R {
 public:
     static void Initialize(const char* packageName);
     static void Destroy();
+
+    /** Reads all ids and layouts using reflection.
+     * Useful before inflating layouts that query lots of ids.
+     */
+    static void Preload();
+
     static int32_t GetID(const char* name);
     static int32_t GetLayout(const char* name);
 private:
+    class ValueCache;
     static void DestroyNoLock();
-    static void InitInnerClass(java::Class*&,const char*);
-    static void DestroyInnerClass(java::Class*&);
-    static int32_t GetInnerClassInt(java::Class*&,const char*,const char*);
+    static java::PClass GetInnerClass(ValueCache&);
+    static void PreloadCache(ValueCache&);
+    static int32_t GetValue(ValueCache&,const char*);
 private:
     static char* m_packageName;
     static pthreadpp::mutex m_lock;
-    static java::Class* m_idClass;
-    static java::Class* m_layoutClass;
+    static ValueCache m_ids;
+    static ValueCache m_layouts;
 };
 
 ///////////////////////////////////////////////////////////////////// IListener
@@ -144,8 +153,8 @@ protected:
 
 ///////////////////////////////////////////////////////////////////// SetNativeInstance
 
-/** Creates and sets native instance identified by \c tag.
- * You should provide implementation of this function.
+/** Creates and sets native instance identified by \c tag using
+ *  factory registered with jb::RegisterNativeFactory().
  */
 void SetNativeInstance(const char* tag,const jni::LObject& object);
 
@@ -175,7 +184,8 @@ typedef java::ObjectPointer<Activity> PActivity;
 /** The activity class you inherit from to make your own
  *  activities.
  * This class calls \c SetNativeInstance() with the full class name
- *  to create concrete native implementation.
+ *  to create concrete native implementation, so register factory
+ *  for each of your activities (see jb::RegisterNativeFactory()).
  */
 class Activity: public Context {
     JB_LIVE_CLASS(Activity);
@@ -16,6 +16,6 @@
 
 APP_PLATFORM := android-9
 
-APP_CPPFLAGS := -fexceptions
+APP_CPPFLAGS := -fexceptions -DJNIPP_NATIVE_INSTANCE_HANDLES
 APP_STL := gnustl_static
 
@@ -43,7 +43,7 @@ void CallRunVirtually() {
 /**************************************/
 
 MyThread::MyThread():
-    LiveThread(java::PString::New("MyThread"))
+    LiveThread(JNIPP_STRING("MyThread"))
 {
 }
 
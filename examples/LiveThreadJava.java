@@ -27,8 +27,9 @@ public class LiveThreadJava extends Thread {
      * Note: implementation for finalize() provided by
      *  JB_DEFINE_LIVE_CLASS macro.
      *
-     * Caveat: since nativeInstance is 'int' 64-bit hosts
-     *  are out of luck.
+     * Note: on 64-bit hosts build with JNIPP_NATIVE_INSTANCE_LONG
+     *  (or JNIPP_NATIVE_INSTANCE_HANDLES) defined and declare
+     *  nativeInstance as 'long'.
      */
     protected native void finalize();
     private int nativeInstance;
@@ -84,11 +84,37 @@ NativeSoundCheckpoint::NativeSoundCheckpoint(const jni::LObject& checkpoint):
 }
 
 jlong NativeSoundCheckpoint::GetTime() const {
-    return JB_GET_THIS(LongField,Time);
+    return GetTime(*this);
 }
 
 java::PObject NativeSoundCheckpoint::GetData() const {
-    return java::PObject::Wrap(JB_GET_THIS(ObjectField,Data));
+    return java::PObject::Wrap(GetData(*this));
+}
+
+jlong NativeSoundCheckpoint::GetTime(const jni::AbstractObject& checkpoint) {
+    return JB_GET(LongField,checkpoint,Time);
+}
+
+jni::LObject NativeSoundCheckpoint::GetData(const jni::AbstractObject& checkpoint) {
+    return JB_GET(ObjectField,checkpoint,Data);
+}
+
+/* Maps Fields members to the fields defined above.
+ */
+typedef NativeSoundCheckpoint::Fields CheckpointFields;
+
+JB_DEFINE_STRUCT(
+    CheckpointFields
+    ,
+    Members
+    (time,Time)
+    (data,Data)
+)
+
+void NativeSoundCheckpoint::ReadRange(const jni::AbstractObject& checkpoints,
+                                      jsize start,jsize length,Fields* fields)
+{
+    JB_READ_STRUCTS(CheckpointFields,checkpoints,start,length,fields);
 }
 
 #undef JB_CURRENT_CLASS
@@ -144,12 +170,19 @@ void NativeSound::Construct(const jni::LObject& thiz,java::PString path) {
 
 NativeSound::NativeSound(const jni::LObject& thiz,java::PString path):
     java::Object(thiz,GetInstanceFieldID()),
-    m_path(path)
+    m_path(path),
+    m_file(0)
 {
     const char* utfPath=path->GetUTF();
 
-    FILE* file=fopen(utfPath,"r");
-    if (!file) {
+    try {
+        // Sound data is mapped rather than read, so it's not copied
+        //  and can be shared with Java through m_file->GetBuffer().
+        m_file=new java::nio::MappedFile(utfPath,
+            java::nio::MappedFile::ReadOnly,
+            java::nio::MappedFile::AdviseSequential);
+    }
+    catch (const jni::AbstractObject&) {
         // The only correct syntax to throw a Java exception:
         //  throw object pointer by value.
         throw PNativeSoundException::New("Can't open file.");
@@ -165,13 +198,12 @@ NativeSound::NativeSound(const jni::LObject& thiz,java::PString path):
         //  stack.
     }
 
-    // Work with file...
-
-    fclose(file);
+    // Work with m_file->GetData()...
 }
 
 NativeSound::~NativeSound() {
     // Free resources.
+    delete m_file;
 }
 
 java::PString NativeSound::GetPath() {
@@ -180,11 +212,31 @@ java::PString NativeSound::GetPath() {
 
 void NativeSound::SetCheckpoints(PCheckpointArray checkpoints) {
     if (checkpoints) {
-        for (int i=0;i!=checkpoints->GetLength();++i) {
-            PCheckpoint checkpoint=checkpoints->GetAt(i);
-            jlong time=checkpoint->GetTime();
-            java::PObject data=checkpoint->GetData();
-            // Register checkpoint.
+        // Fields are read without creating wrappers for elements,
+        //  which matters when there are lots of checkpoints. Each
+        //  'data' holds a local reference, so checkpoints are read
+        //  in batches, each in its own local frame.
+        const jsize BatchLength=64;
+        jsize length=checkpoints->GetLength();
+        for (jsize start=0;start<length;start+=BatchLength) {
+            jsize batchLength=std::min(BatchLength,length-start);
+            jni::PushLocalFrame(batchLength);
+            try {
+                Checkpoint::Fields fields[BatchLength];
+                Checkpoint::ReadRange(*checkpoints,start,batchLength,fields);
+                for (jsize i=0;i!=batchLength;++i) {
+                    jlong time=fields[i].time;
+                    const jni::LObject& data=fields[i].data;
+                    // Register checkpoint.
+                    (void)time;
+                    (void)data;
+                }
+            }
+            catch (...) {
+                jni::PopLocalFrame();
+                throw;
+            }
+            jni::PopLocalFrame();
         }
     }
 }
@@ -46,6 +46,27 @@ public:
 
     jlong GetTime() const;
     java::PObject GetData() const;
+
+    /* Versions that work on any reference to Checkpoint object,
+     *  e.g. on elements of CheckpointArray::Reader. GetData() returns
+     *  local reference, so it's released with the reader's batch.
+     */
+    static jlong GetTime(const jni::AbstractObject& checkpoint);
+    static jni::LObject GetData(const jni::AbstractObject& checkpoint);
+
+    /* Plain copy of Checkpoint's fields.
+     */
+    struct Fields {
+        jlong time;
+        jni::LObject data;
+    };
+
+    /* Reads fields of \c length checkpoints starting at \c start at
+     *  once, which is much faster than calling GetTime()/GetData()
+     *  for each one.
+     */
+    static void ReadRange(const jni::AbstractObject& checkpoints,
+                          jsize start,jsize length,Fields* fields);
 };
 
 
@@ -99,6 +120,7 @@ private:
     static void Construct(const jni::LObject&,java::PString path);
 private:
     java::PString m_path;
+    java::nio::MappedFile* m_file;
 };
 
 #endif // NATIVESOUND_INCLUDED
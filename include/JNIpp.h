@@ -21,6 +21,9 @@
 #include "JNIpp/JavaNI.h"
 #include "JNIpp/JavaLang.h"
 #include "JNIpp/JavaArray.h"
+#include "JNIpp/JavaAlgorithms.h"
+#include "JNIpp/JavaNio.h"
+#include "JNIpp/JavaPacked.h"
 
 /**
  * \example EmailValidator.h
@@ -100,8 +103,6 @@
     next release. For now you have to use raw functions from JNIEnv:
     <tt> jni::GetEnv()->MonitorEnter(obj.GetJObject()). </tt>
     Wrap calls in RAII object!
- - No support for GetElements/SetElements in java::PrimitiveArray.
-    Use Get/ReleaseXXXArrayElements from #jni namespace (e.g. jni::GetIntArrayElements).
  - Other issues, see numerous TODOs in the source files.
  */
 
@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file
+ * Contains bulk algorithms over primitive arrays.
+ */
+
+#ifndef _JNIPP_JAVAALGORITHMS_INCLUDED_
+#define _JNIPP_JAVAALGORITHMS_INCLUDED_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include "JavaArray.h"
+
+BEGIN_NAMESPACE(java)
+
+/** Contains algorithms that work directly on elements of primitive
+ *  arrays.
+ *
+ * Each algorithm pins its arrays once (see PrimitiveArray::Critical)
+ *  and splits large inputs across a pool of worker threads, so a
+ *  single native call gives Java native-speed bulk math:
+ * \code
+ * jdouble Average(const jni::LObject&,java::PFloatArray samples) {
+ *     return java::algorithms::Sum(*samples)/samples->GetLength();
+ * }
+ * \endcode
+ *
+ * While arrays are pinned garbage collector may be blocked, so don't
+ *  use these functions on arrays that take long to process, and don't
+ *  call #jni functions from functors passed to Transform().
+ *
+ * Only numeric arrays are supported (not BoolArray).
+ */
+BEGIN_NAMESPACE(algorithms)
+
+///////////////////////////////////////////////////////////////////// ParallelFor
+
+/** Maximum number of chunks input is split into.
+ */
+const size_t MaxChunks=64;
+
+/** Default minimum number of elements per chunk. Inputs shorter than
+ *  that are processed on the calling thread.
+ */
+const size_t DefaultGrain=16*1024;
+
+/** Function called for each chunk by ParallelFor().
+ */
+typedef void (*ChunkFunction)(void* context,size_t chunk,size_t begin,size_t end);
+
+/** Returns number of chunks ParallelFor() splits \c length elements
+ *  into; never greater than MaxChunks.
+ */
+size_t GetChunkCount(size_t length,size_t grain);
+
+/** Returns number of worker threads (not counting the calling thread).
+ */
+size_t GetWorkerCount();
+
+/** Splits [0,length) into GetChunkCount() chunks and calls \c function
+ *  for each chunk on worker threads and on the calling thread. Returns
+ *  after all chunks are processed.
+ * Chunk \c i spans [length*i/count,length*(i+1)/count).
+ *
+ * Function must not throw. If pool is busy (e.g. ParallelFor() is
+ *  called from a chunk function) chunks are processed on the calling
+ *  thread.
+ */
+void ParallelFor(size_t length,size_t grain,ChunkFunction function,void* context);
+
+/** Calls <tt> body(chunk,begin,end) </tt> for each chunk, see
+ *  ParallelFor(size_t,size_t,ChunkFunction,void*).
+ */
+template <class Body>
+inline void ParallelFor(size_t length,size_t grain,Body& body);
+
+///////////////////////////////////////////////////////////////////// algorithms
+
+/** Type used to sum elements of \c JType: \c jlong for integer
+ *  types and \c jdouble for floating point ones.
+ */
+template <class JType>
+struct SumType {
+    typedef jlong Type;
+};
+
+template <>
+struct SumType<jfloat> {
+    typedef jdouble Type;
+};
+
+template <>
+struct SumType<jdouble> {
+    typedef jdouble Type;
+};
+
+/** Returns sum of elements. Integer sums wrap around like in Java.
+ */
+template <class JType>
+typename SumType<JType>::Type Sum(PrimitiveArray<JType>& array);
+
+/** Returns dot product of two arrays of equal length. Integer
+ *  products and sums wrap around like in Java.
+ */
+template <class JType>
+typename SumType<JType>::Type Dot(PrimitiveArray<JType>& array1,PrimitiveArray<JType>& array2);
+
+/** Returns minimum element of non-empty array. If array contains
+ *  NaN, NaN is returned, like \c Math.min() does.
+ */
+template <class JType>
+JType Min(PrimitiveArray<JType>& array);
+
+/** Returns maximum element of non-empty array. If array contains
+ *  NaN, NaN is returned, like \c Math.max() does.
+ */
+template <class JType>
+JType Max(PrimitiveArray<JType>& array);
+
+/** Replaces each element \c x with <tt> function(x) </tt>.
+ * Function is copied for each chunk and called concurrently.
+ */
+template <class JType,class Function>
+void Transform(PrimitiveArray<JType>& array,Function function);
+
+/** Replaces each element with sum of it and all preceding elements
+ *  (inclusive prefix sum). Integer sums wrap around like in Java.
+ */
+template <class JType>
+void PrefixSum(PrimitiveArray<JType>& array);
+
+/** Sorts array in ascending order. NaNs are placed at the end,
+ *  like \c java.util.Arrays.sort() does.
+ */
+template <class JType>
+void Sort(PrimitiveArray<JType>& array);
+
+/** Searches sorted array for \c value. Returns index of the value
+ *  if it is found, otherwise <tt> -(insertion point)-1 </tt>, like
+ *  \c java.util.Arrays.binarySearch() does.
+ */
+template <class JType>
+jint BinarySearch(PrimitiveArray<JType>& array,JType value);
+
+///////////////////////////////////////////////////////////////////// implementation
+
+/* Implementation details. */
+
+template <class Body>
+inline void CallChunkBody(void* context,size_t chunk,size_t begin,size_t end) {
+    (*static_cast<Body*>(context))(chunk,begin,end);
+}
+
+template <class Body>
+inline void ParallelFor(size_t length,size_t grain,Body& body) {
+    ParallelFor(length,grain,&CallChunkBody<Body>,&body);
+}
+
+/* Type that integer arithmetic is done in, so that it wraps around
+ *  instead of overflowing (which is undefined for signed types).
+ */
+template <class T>
+struct WrappingType {
+    typedef T Type;
+};
+
+template <>
+struct WrappingType<jbyte> {
+    typedef uint8_t Type;
+};
+
+template <>
+struct WrappingType<jshort> {
+    typedef uint16_t Type;
+};
+
+template <>
+struct WrappingType<jint> {
+    typedef uint32_t Type;
+};
+
+template <>
+struct WrappingType<jlong> {
+    typedef uint64_t Type;
+};
+
+/* Ordering that places NaNs last. For integers (x!=x) is always
+ *  false and is optimized out.
+ */
+template <class JType>
+struct NaNLastLess {
+    bool operator()(JType a,JType b) const {
+        return (a<b) || (b!=b && a==a);
+    }
+};
+
+///////////////////////////////////////////////// Sum, Dot
+
+template <class JType>
+struct SumBody {
+    typedef typename WrappingType<typename SumType<JType>::Type>::Type Result;
+
+    const JType* data;
+    Result partials[MaxChunks];
+
+    void operator()(size_t chunk,size_t begin,size_t end) {
+        // Independent accumulators let compiler vectorize and
+        //  pipeline additions.
+        Result sum0=0,sum1=0,sum2=0,sum3=0;
+        size_t i=begin;
+        for (;i+4<=end;i+=4) {
+            sum0+=data[i];
+            sum1+=data[i+1];
+            sum2+=data[i+2];
+            sum3+=data[i+3];
+        }
+        for (;i!=end;++i) {
+            sum0+=data[i];
+        }
+        partials[chunk]=(sum0+sum1)+(sum2+sum3);
+    }
+};
+
+template <class JType>
+typename SumType<JType>::Type Sum(PrimitiveArray<JType>& array) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    SumBody<JType> body;
+    body.data=critical.GetData();
+    size_t length=size_t(critical.GetLength());
+    ParallelFor(length,DefaultGrain,body);
+    critical.Abort();
+
+    typename SumBody<JType>::Result sum=0;
+    for (size_t i=0,count=GetChunkCount(length,DefaultGrain);i!=count;++i) {
+        sum+=body.partials[i];
+    }
+    return typename SumType<JType>::Type(sum);
+}
+
+template <class JType>
+struct DotBody {
+    typedef typename WrappingType<typename SumType<JType>::Type>::Type Result;
+
+    const JType* data1;
+    const JType* data2;
+    Result partials[MaxChunks];
+
+    void operator()(size_t chunk,size_t begin,size_t end) {
+        Result sum0=0,sum1=0,sum2=0,sum3=0;
+        size_t i=begin;
+        for (;i+4<=end;i+=4) {
+            sum0+=Result(data1[i])*Result(data2[i]);
+            sum1+=Result(data1[i+1])*Result(data2[i+1]);
+            sum2+=Result(data1[i+2])*Result(data2[i+2]);
+            sum3+=Result(data1[i+3])*Result(data2[i+3]);
+        }
+        for (;i!=end;++i) {
+            sum0+=Result(data1[i])*Result(data2[i]);
+        }
+        partials[chunk]=(sum0+sum1)+(sum2+sum3);
+    }
+};
+
+template <class JType>
+typename SumType<JType>::Type Dot(PrimitiveArray<JType>& array1,PrimitiveArray<JType>& array2) {
+    if (array1.GetLength()!=array2.GetLength()) {
+        jni::FatalError("Dot: arrays have different lengths (%d and %d).",
+            array1.GetLength(),array2.GetLength());
+    }
+    CriticalArrays arrays;
+    size_t index1=arrays.Add(array1);
+    size_t index2=arrays.Add(array2);
+    arrays.Pin();
+    DotBody<JType> body;
+    body.data1=arrays.GetData<JType>(index1);
+    body.data2=arrays.GetData<JType>(index2);
+    size_t length=size_t(arrays.GetLength(index1));
+    ParallelFor(length,DefaultGrain,body);
+    arrays.Release(false);
+
+    typename DotBody<JType>::Result sum=0;
+    for (size_t i=0,count=GetChunkCount(length,DefaultGrain);i!=count;++i) {
+        sum+=body.partials[i];
+    }
+    return typename SumType<JType>::Type(sum);
+}
+
+///////////////////////////////////////////////// Min, Max
+
+/* NaN wins in all comparisons, so it's returned by any chunk that
+ *  has it and then by MinMax(). For integers (x!=x) is always false
+ *  and is optimized out.
+ */
+template <class JType,bool IsMin>
+inline bool IsMinMaxBetter(JType value,JType result) {
+    return (value!=value) || (IsMin ? (value<result) : (result<value));
+}
+
+template <class JType,bool IsMin>
+struct MinMaxBody {
+    const JType* data;
+    JType partials[MaxChunks];
+
+    void operator()(size_t chunk,size_t begin,size_t end) {
+        JType result=data[begin];
+        for (size_t i=begin+1;i!=end && result==result;++i) {
+            JType value=data[i];
+            if (IsMinMaxBetter<JType,IsMin>(value,result)) {
+                result=value;
+            }
+        }
+        partials[chunk]=result;
+    }
+};
+
+template <class JType,bool IsMin>
+JType MinMax(PrimitiveArray<JType>& array) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    size_t length=size_t(critical.GetLength());
+    if (!length) {
+        jni::FatalError("%s: array is empty.",IsMin ? "Min" : "Max");
+    }
+    MinMaxBody<JType,IsMin> body;
+    body.data=critical.GetData();
+    ParallelFor(length,DefaultGrain,body);
+    critical.Abort();
+
+    JType result=body.partials[0];
+    for (size_t i=1,count=GetChunkCount(length,DefaultGrain);i!=count && result==result;++i) {
+        if (IsMinMaxBetter<JType,IsMin>(body.partials[i],result)) {
+            result=body.partials[i];
+        }
+    }
+    return result;
+}
+
+template <class JType>
+JType Min(PrimitiveArray<JType>& array) {
+    return MinMax<JType,true>(array);
+}
+
+template <class JType>
+JType Max(PrimitiveArray<JType>& array) {
+    return MinMax<JType,false>(array);
+}
+
+///////////////////////////////////////////////// Transform
+
+template <class JType,class Function>
+struct TransformBody {
+    JType* data;
+    const Function* function;
+
+    void operator()(size_t,size_t begin,size_t end) {
+        Function localFunction(*function);
+        for (size_t i=begin;i!=end;++i) {
+            data[i]=localFunction(data[i]);
+        }
+    }
+};
+
+template <class JType,class Function>
+void Transform(PrimitiveArray<JType>& array,Function function) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    TransformBody<JType,Function> body;
+    body.data=critical.GetData();
+    body.function=&function;
+    ParallelFor(size_t(critical.GetLength()),DefaultGrain,body);
+}
+
+///////////////////////////////////////////////// PrefixSum
+
+template <class JType>
+struct PrefixSumBody {
+    typedef typename WrappingType<JType>::Type Sum;
+
+    JType* data;
+    Sum offsets[MaxChunks];
+    bool addOffsets;
+
+    void operator()(size_t chunk,size_t begin,size_t end) {
+        if (!addOffsets) {
+            // First pass: scan chunk, remember its total.
+            Sum sum=0;
+            for (size_t i=begin;i!=end;++i) {
+                sum=Sum(sum+Sum(data[i]));
+                data[i]=JType(sum);
+            }
+            offsets[chunk]=sum;
+        } else if (chunk) {
+            // Second pass: add totals of preceding chunks.
+            Sum offset=offsets[chunk-1];
+            for (size_t i=begin;i!=end;++i) {
+                data[i]=JType(Sum(Sum(data[i])+offset));
+            }
+        }
+    }
+};
+
+template <class JType>
+void PrefixSum(PrimitiveArray<JType>& array) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    size_t length=size_t(critical.GetLength());
+    PrefixSumBody<JType> body;
+    body.data=critical.GetData();
+    body.addOffsets=false;
+    ParallelFor(length,DefaultGrain,body);
+
+    size_t count=GetChunkCount(length,DefaultGrain);
+    if (count>1) {
+        // Turn chunk totals into running totals.
+        for (size_t i=1;i!=count;++i) {
+            body.offsets[i]=typename PrefixSumBody<JType>::Sum(
+                body.offsets[i]+body.offsets[i-1]);
+        }
+        body.addOffsets=true;
+        ParallelFor(length,DefaultGrain,body);
+    }
+}
+
+///////////////////////////////////////////////// Sort
+
+template <class JType>
+struct SortBody {
+    JType* data;
+    size_t length;
+    size_t chunkCount;
+    size_t mergeWidth;
+
+    size_t GetBound(size_t chunk) const {
+        if (chunk>=chunkCount) {
+            return length;
+        }
+        return length*chunk/chunkCount;
+    }
+
+    void operator()(size_t,size_t begin,size_t end) {
+        if (!mergeWidth) {
+            // Chunks are sorted individually.
+            std::sort(data+begin,data+end,NaNLastLess<JType>());
+            return;
+        }
+        // Elements of [begin,end) are indices of merge pairs.
+        for (size_t pair=begin;pair!=end;++pair) {
+            size_t first=pair*2*mergeWidth;
+            std::inplace_merge(
+                data+GetBound(first),
+                data+GetBound(first+mergeWidth),
+                data+GetBound(first+2*mergeWidth),
+                NaNLastLess<JType>());
+        }
+    }
+};
+
+template <class JType>
+void Sort(PrimitiveArray<JType>& array) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    SortBody<JType> body;
+    body.data=critical.GetData();
+    body.length=size_t(critical.GetLength());
+    body.chunkCount=GetChunkCount(body.length,DefaultGrain);
+    body.mergeWidth=0;
+    ParallelFor(body.length,DefaultGrain,body);
+
+    // Merge sorted chunks pairwise, pairs of each level in parallel.
+    for (size_t width=1;width<body.chunkCount;width*=2) {
+        body.mergeWidth=width;
+        size_t pairs=(body.chunkCount+2*width-1)/(2*width);
+        ParallelFor(pairs,1,body);
+    }
+}
+
+///////////////////////////////////////////////// BinarySearch
+
+template <class JType>
+jint BinarySearch(PrimitiveArray<JType>& array,JType value) {
+    typename PrimitiveArray<JType>::Critical critical(array);
+    const JType* found=std::lower_bound(
+        critical.Begin(),critical.End(),
+        value,NaNLastLess<JType>());
+    jint index=jint(found-critical.Begin());
+    bool equal=(found!=critical.End() &&
+        !NaNLastLess<JType>()(value,*found));
+    critical.Abort();
+    return equal ? index : -index-1;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(algorithms)
+
+END_NAMESPACE(java)
+
+#endif // _JNIPP_JAVAALGORITHMS_INCLUDED_
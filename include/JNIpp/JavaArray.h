@@ -21,10 +21,50 @@
 #ifndef _JNIPP_JAVARRAY_INCLUDED_
 #define _JNIPP_JAVARRAY_INCLUDED_
 
+#include <stddef.h>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
 #include "JavaLang.h"
 
 BEGIN_NAMESPACE(java)
 
+///////////////////////////////////////////////////////////////////// element conversion
+
+/** Converts \c length elements with \c static_cast.
+ * Used by PrimitiveArray::FromRange() and PrimitiveArray::CopyTo().
+ *  Non-template overloads below do the same for common pairs of types,
+ *  but use SSE2/NEON when compiler targets them.
+ */
+template <class From,class To>
+inline void ConvertElements(const From* in,size_t length,To* out) {
+    for (size_t i=0;i!=length;++i) {
+        out[i]=static_cast<To>(in[i]);
+    }
+}
+
+/** Narrows doubles to floats.
+ */
+void ConvertElements(const jdouble* in,size_t length,jfloat* out);
+
+/** Widens floats to doubles.
+ */
+void ConvertElements(const jfloat* in,size_t length,jdouble* out);
+
+/** Widens signed 16-bit integers to ints.
+ */
+void ConvertElements(const jshort* in,size_t length,jint* out);
+
+/** Widens unsigned 16-bit integers (\c jchar, \c uint16_t) to ints.
+ */
+void ConvertElements(const jchar* in,size_t length,jint* out);
+
+/** Converts ints to floats.
+ */
+void ConvertElements(const jint* in,size_t length,jfloat* out);
+
 ///////////////////////////////////////////////////////////////////// PrimitiveArray
 
 /** Wrapper for primitive arrays (like \c int[]).
@@ -80,14 +120,797 @@ public:
      */
     void SetRegion(jsize start,jsize length,const JType* elements);
 
+    /** Creates Java array of the specified length without wrapping it.
+     */
+    static jni::LObject NewArray(jsize length);
+
+    /** Same as GetRegion(), but works on any reference to array,
+     *  e.g. on elements of ObjectArrayReader.
+     */
+    static void GetRegion(const jni::AbstractObject& array,jsize start,jsize length,JType* buffer);
+
+    /** Same as SetRegion(), but works on any reference to array.
+     */
+    static void SetRegion(const jni::AbstractObject& array,jsize start,jsize length,const JType* elements);
+
+    /** Creates array from elements in [first,last), converting them
+     *  to \c JType with \c static_cast:
+     * \code
+     * std::vector<double> values=...;
+     * java::PFloatArray array=java::FloatArray::FromRange(
+     *     &values[0],&values[0]+values.size());
+     * \endcode
+     * Elements are converted in chunks on stack, one region call
+     *  per chunk; no temporary buffer is allocated.
+     */
+    template <class T>
+    static ObjectPointer<PrimitiveArray> FromRange(const T* first,const T* last);
+
+    /** Creates array from \c values, see FromRange(const T*,const T*).
+     */
+    template <class T>
+    static ObjectPointer<PrimitiveArray> FromRange(const std::vector<T>& values) {
+        const T* first=values.empty() ? 0 : &values[0];
+        return FromRange(first,first+values.size());
+    }
+
+    /** Stores elements from [first,last) starting at \c start,
+     *  converting them to \c JType.
+     */
+    template <class T>
+    void SetRange(jsize start,const T* first,const T* last);
+
+    /** Same as above, but elements don't need conversion and are
+     *  stored with a single region call.
+     */
+    void SetRange(jsize start,const JType* first,const JType* last) {
+        SetRegion(start,jsize(last-first),first);
+    }
+
+    /** Copies \c length elements starting at \c start to \c out,
+     *  converting them to \c T.
+     */
+    template <class T>
+    void CopyTo(jsize start,jsize length,T* out) const;
+
+    /** Same as above, but elements don't need conversion and are
+     *  copied with a single region call.
+     */
+    void CopyTo(jsize start,jsize length,JType* out) const {
+        GetRegion(start,length,out);
+    }
+
+    /** Copies all elements to \c out (which is resized),
+     *  converting them to \c T.
+     */
+    template <class T>
+    void CopyTo(std::vector<T>& out) const {
+        out.resize(size_t(GetLength()));
+        if (!out.empty()) {
+            CopyTo(0,GetLength(),&out[0]);
+        }
+    }
+
+    class Elements;
+    class Critical;
+    class Window;
+
+    /** Returns \c true if elements can be accessed directly via
+     *  Critical or CriticalArrays. Only PrimitiveArray<bool> may
+     *  return \c false (see jni::JBooleanIsBool).
+     */
+    static bool IsCriticalSupported() {
+        return true;
+    }
+
+private:
+    /* Size of stack buffer used by SetRange() and CopyTo(). */
+    enum { ConversionChunkLength=2048/sizeof(JType) };
+
+    static JType* GetElements(const PrimitiveArray& array,bool* isCopy);
+    static void ReleaseElements(const PrimitiveArray& array,JType* elements,jni::ArrayReleaseMode mode);
 private:
     mutable jsize m_length;
     static java::Class* m_class;
 };
 
+template <>
+inline bool PrimitiveArray<bool>::IsCriticalSupported() {
+    return jni::JBooleanIsBool;
+}
+
+///////////////////////////////////////////////// PrimitiveArray::Elements
+
+/** Scoped access to elements of a primitive array.
+ *
+ * Constructor locks array elements with jni::GetXXXArrayElements(),
+ *  destructor commits changes and releases the elements (unless
+ *  Release() or Abort() was called). This allows processing large
+ *  arrays in place, without copying them through GetRegion() and
+ *  SetRegion():
+ * \code
+ * java::PIntArray array=...;
+ * {
+ *     java::IntArray::Elements elements(*array);
+ *     for (jint* i=elements.Begin();i!=elements.End();++i) {
+ *         *i*=2;
+ *     }
+ * } // changes are committed here
+ * \endcode
+ *
+ * The array must outlive the accessor.
+ */
+template <class JType>
+class PrimitiveArray<JType>::Elements {
+public:
+    /** Locks elements of the \c array.
+     */
+    explicit Elements(PrimitiveArray& array):
+        m_array(array),
+        m_elements(0),
+        m_length(array.GetLength()),
+        m_isCopy(false)
+    {
+        m_elements=GetElements(m_array,&m_isCopy);
+    }
+
+    /** Commits changes and releases elements if they were not
+     *  released already.
+     */
+    ~Elements() {
+        if (m_elements) {
+            ReleaseElements(m_array,m_elements,jni::CommitFreeElements);
+        }
+    }
+
+    /** Returns elements; NULL after Release() or Abort().
+     */
+    JType* GetData() const {
+        return m_elements;
+    }
+
+    /** Returns number of elements.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+    /** Returns element at \c index.
+     */
+    JType& operator[](jsize index) const {
+        return m_elements[index];
+    }
+
+    /** Returns pointer to the first element.
+     */
+    JType* Begin() const {
+        return m_elements;
+    }
+
+    /** Returns pointer past the last element.
+     */
+    JType* End() const {
+        return m_elements+m_length;
+    }
+
+    /** Returns \c true if VM made a copy of the elements. In that
+     *  case changes are not visible to Java until committed.
+     */
+    bool IsCopy() const {
+        return m_isCopy;
+    }
+
+    /** Copies changes back to the array, elements stay locked
+     *  (\c JNI_COMMIT). Does nothing if elements are not a copy.
+     */
+    void Commit() {
+        if (m_elements && m_isCopy) {
+            ReleaseElements(m_array,m_elements,jni::CommitElements);
+        }
+    }
+
+    /** Releases elements without copying changes back (\c JNI_ABORT).
+     * If elements are not a copy, changes are already in the array.
+     */
+    void Abort() {
+        Release(jni::FreeElements);
+    }
+
+    /** Copies changes back and releases elements (mode \c 0).
+     */
+    void Release() {
+        Release(jni::CommitFreeElements);
+    }
+
+    /** Releases elements using the specified \c mode.
+     * jni::CommitElements mode is equivalent to Commit().
+     */
+    void Release(jni::ArrayReleaseMode mode) {
+        if (mode==jni::CommitElements) {
+            Commit();
+        } else if (m_elements) {
+            JType* elements=m_elements;
+            m_elements=0;
+            ReleaseElements(m_array,elements,mode);
+        }
+    }
+
+private:
+    Elements(const Elements&);
+    Elements& operator=(const Elements&);
+private:
+    PrimitiveArray& m_array;
+    JType* m_elements;
+    jsize m_length;
+    bool m_isCopy;
+};
+
 template <class JType>
 java::Class* PrimitiveArray<JType>::m_class=0;
 
+///////////////////////////////////////////////// PrimitiveArray::Critical
+
+/** Scoped critical access to elements of a primitive array.
+ *
+ * Same as Elements, but uses jni::GetPrimitiveArrayCritical(), which
+ *  makes it much more likely that VM will return pointer to the array
+ *  itself instead of a copy.
+ *
+ * While the accessor exists current thread is in a "critical region":
+ *  it must not call any #jni functions (that includes creating and
+ *  destroying java::Object wrappers) and must not block waiting for
+ *  other threads that may do so. In debug builds violations are
+ *  caught by jni::GetEnv(). To pin several arrays at once use
+ *  CriticalArrays.
+ * \code
+ * java::PFloatArray samples=...;
+ * {
+ *     java::FloatArray::Critical critical(*samples);
+ *     Process(critical.GetData(),critical.GetLength());
+ * }
+ * \endcode
+ */
+template <class JType>
+class PrimitiveArray<JType>::Critical {
+public:
+    /** Enters critical region and locks elements of the \c array.
+     */
+    explicit Critical(PrimitiveArray& array):
+        m_array(array),
+        m_elements(0),
+        m_length(array.GetLength()),
+        m_isCopy(false)
+    {
+        if (!IsCriticalSupported()) {
+            jni::FatalError("PrimitiveArray::Critical is not supported for this element type.");
+        }
+        m_elements=static_cast<JType*>(
+            jni::GetPrimitiveArrayCritical(m_array,&m_isCopy));
+        if (!m_elements) {
+            jni::TranslateJavaException();
+        }
+    }
+
+    /** Commits changes, releases elements and leaves critical
+     *  region if elements were not released already.
+     */
+    ~Critical() {
+        Release();
+    }
+
+    /** Returns elements; NULL after Release() or Abort().
+     */
+    JType* GetData() const {
+        return m_elements;
+    }
+
+    /** Returns number of elements.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+    /** Returns element at \c index.
+     */
+    JType& operator[](jsize index) const {
+        return m_elements[index];
+    }
+
+    /** Returns pointer to the first element.
+     */
+    JType* Begin() const {
+        return m_elements;
+    }
+
+    /** Returns pointer past the last element.
+     */
+    JType* End() const {
+        return m_elements+m_length;
+    }
+
+    /** Returns \c true if VM made a copy of the elements.
+     */
+    bool IsCopy() const {
+        return m_isCopy;
+    }
+
+    /** Releases elements without copying changes back (\c JNI_ABORT)
+     *  and leaves critical region.
+     */
+    void Abort() {
+        Release(jni::FreeElements);
+    }
+
+    /** Copies changes back, releases elements and leaves critical
+     *  region.
+     */
+    void Release() {
+        Release(jni::CommitFreeElements);
+    }
+
+private:
+    Critical(const Critical&);
+    Critical& operator=(const Critical&);
+    void Release(jni::ArrayReleaseMode mode) {
+        if (m_elements) {
+            JType* elements=m_elements;
+            m_elements=0;
+            jni::ReleasePrimitiveArrayCritical(m_array,elements,mode);
+        }
+    }
+private:
+    PrimitiveArray& m_array;
+    JType* m_elements;
+    jsize m_length;
+    bool m_isCopy;
+};
+
+///////////////////////////////////////////////// PrimitiveArray::Window
+
+/** Buffered random-access view of a primitive array.
+ *
+ * Window reads array elements in 4 KB chunks with GetRegion() and
+ *  keeps a few recently used chunks, so iterating over the array
+ *  costs one #jni call per chunk instead of one per element. Changes
+ *  are written back with SetRegion() when a modified chunk is evicted,
+ *  on Flush() and in destructor. Destructor ignores errors, so call
+ *  Flush() explicitly when write failures matter.
+ *
+ * Window provides random-access iterators, so standard algorithms
+ *  work on Java arrays:
+ * \code
+ * java::PIntArray array=...;
+ * java::IntArray::Window window(*array);
+ * jint sum=std::accumulate(window.begin(),window.end(),0);
+ * std::sort(window.begin(),window.end());
+ * \endcode
+ * Iterators dereference to Reference proxies which convert to
+ *  and can be assigned from \c JType.
+ *
+ * Window is not thread safe. The array must outlive the window.
+ *  Changes made to the array by other means while the window
+ *  exists may be not visible or may be overwritten.
+ */
+template <class JType>
+class PrimitiveArray<JType>::Window {
+public:
+    class Iterator;
+
+    /** Proxy reference to an array element.
+     */
+    class Reference {
+    public:
+        operator JType() const {
+            return m_window->Get(m_index);
+        }
+        Reference& operator=(JType value) {
+            m_window->Set(m_index,value);
+            return *this;
+        }
+        Reference& operator=(const Reference& other) {
+            m_window->Set(m_index,JType(other));
+            return *this;
+        }
+        Reference& operator+=(JType value) {
+            return operator=(JType(*this)+value);
+        }
+        Reference& operator-=(JType value) {
+            return operator=(JType(*this)-value);
+        }
+        Reference& operator*=(JType value) {
+            return operator=(JType(*this)*value);
+        }
+        Reference& operator/=(JType value) {
+            return operator=(JType(*this)/value);
+        }
+        friend void swap(Reference a,Reference b) {
+            JType value=a;
+            a=JType(b);
+            b=value;
+        }
+    private:
+        friend class Window;
+        friend class Iterator;
+        Reference(Window* window,jsize index):
+            m_window(window),
+            m_index(index)
+        {
+        }
+    private:
+        Window* m_window;
+        jsize m_index;
+    };
+
+    /** Random-access iterator.
+     */
+    class Iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef JType value_type;
+        typedef ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef Reference reference;
+
+        Iterator():
+            m_window(0),
+            m_index(0)
+        {
+        }
+
+        Reference operator*() const {
+            return Reference(m_window,m_index);
+        }
+        Reference operator[](difference_type offset) const {
+            return Reference(m_window,jsize(m_index+offset));
+        }
+
+        Iterator& operator++() {
+            ++m_index;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator result=*this;
+            ++m_index;
+            return result;
+        }
+        Iterator& operator--() {
+            --m_index;
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator result=*this;
+            --m_index;
+            return result;
+        }
+        Iterator& operator+=(difference_type offset) {
+            m_index+=jsize(offset);
+            return *this;
+        }
+        Iterator& operator-=(difference_type offset) {
+            m_index-=jsize(offset);
+            return *this;
+        }
+        Iterator operator+(difference_type offset) const {
+            return Iterator(m_window,jsize(m_index+offset));
+        }
+        Iterator operator-(difference_type offset) const {
+            return Iterator(m_window,jsize(m_index-offset));
+        }
+        friend Iterator operator+(difference_type offset,const Iterator& iterator) {
+            return iterator+offset;
+        }
+        difference_type operator-(const Iterator& other) const {
+            return difference_type(m_index)-other.m_index;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return m_index==other.m_index;
+        }
+        bool operator!=(const Iterator& other) const {
+            return m_index!=other.m_index;
+        }
+        bool operator<(const Iterator& other) const {
+            return m_index<other.m_index;
+        }
+        bool operator>(const Iterator& other) const {
+            return m_index>other.m_index;
+        }
+        bool operator<=(const Iterator& other) const {
+            return m_index<=other.m_index;
+        }
+        bool operator>=(const Iterator& other) const {
+            return m_index>=other.m_index;
+        }
+    private:
+        friend class Window;
+        Iterator(Window* window,jsize index):
+            m_window(window),
+            m_index(index)
+        {
+        }
+    private:
+        Window* m_window;
+        jsize m_index;
+    };
+
+    /** Creates window for the \c array. Nothing is read until
+     *  elements are accessed.
+     */
+    explicit Window(PrimitiveArray& array):
+        m_array(array),
+        m_length(array.GetLength()),
+        m_slots(new Slot[SlotCount]),
+        m_lastSlot(0),
+        m_useCount(0)
+    {
+        for (size_t i=0;i!=SlotCount;++i) {
+            Slot& slot=m_slots[i];
+            slot.start=-1;
+            slot.length=0;
+            slot.dirtyStart=slot.dirtyEnd=0;
+            slot.lastUse=0;
+        }
+    }
+
+    /** Writes changes back to the array.
+     * Errors are ignored since destructor can't throw; call Flush()
+     *  first if they need to be handled.
+     */
+    ~Window() {
+        for (size_t i=0;i!=SlotCount;++i) {
+            try {
+                FlushSlot(m_slots[i]);
+            } catch (...) {
+                // Changes in this slot are lost.
+            }
+        }
+        delete[] m_slots;
+    }
+
+    /** Returns number of elements.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+    /** Returns element at \c index.
+     */
+    JType Get(jsize index) {
+        return *Locate(index);
+    }
+
+    /** Sets element at \c index.
+     */
+    void Set(jsize index,JType value) {
+        Slot& slot=*LocateSlot(index);
+        slot.data[index-slot.start]=value;
+        if (slot.dirtyStart==slot.dirtyEnd) {
+            slot.dirtyStart=index;
+            slot.dirtyEnd=index+1;
+        } else if (index<slot.dirtyStart) {
+            slot.dirtyStart=index;
+        } else if (index>=slot.dirtyEnd) {
+            slot.dirtyEnd=index+1;
+        }
+    }
+
+    /** Writes changes back to the array.
+     * Throws translated Java exception if writing fails.
+     */
+    void Flush() {
+        for (size_t i=0;i!=SlotCount;++i) {
+            FlushSlot(m_slots[i]);
+        }
+    }
+
+    /** Returns iterator to the first element.
+     */
+    Iterator begin() {
+        return Iterator(this,0);
+    }
+
+    /** Returns iterator past the last element.
+     */
+    Iterator end() {
+        return Iterator(this,m_length);
+    }
+
+private:
+    enum {
+        ChunkLength=4096/sizeof(JType),
+        SlotCount=4
+    };
+    struct Slot {
+        jsize start;
+        jsize length;
+        jsize dirtyStart;
+        jsize dirtyEnd;
+        unsigned lastUse;
+        JType data[ChunkLength];
+    };
+private:
+    Window(const Window&);
+    Window& operator=(const Window&);
+
+    JType* Locate(jsize index) {
+        Slot& slot=*LocateSlot(index);
+        return slot.data+(index-slot.start);
+    }
+
+    Slot* LocateSlot(jsize index) {
+        Slot* slot=m_lastSlot;
+        if (slot && index>=slot->start && index<slot->start+slot->length) {
+            return slot;
+        }
+        Slot* victim=m_slots;
+        for (size_t i=0;i!=SlotCount;++i) {
+            slot=m_slots+i;
+            if (index>=slot->start && index<slot->start+slot->length) {
+                victim=0;
+                break;
+            }
+            if (slot->lastUse<victim->lastUse) {
+                victim=slot;
+            }
+        }
+        if (victim) {
+            slot=victim;
+            FlushSlot(*slot);
+            if (index<0 || index>=m_length) {
+                jni::FatalError("PrimitiveArray::Window: index %d is out of bounds [0,%d).",
+                    index,m_length);
+            }
+            slot->start=index-index%jsize(ChunkLength);
+            slot->length=std::min(jsize(ChunkLength),m_length-slot->start);
+            slot->dirtyStart=slot->dirtyEnd=0;
+            m_array.GetRegion(slot->start,slot->length,slot->data);
+        }
+        slot->lastUse=++m_useCount;
+        m_lastSlot=slot;
+        return slot;
+    }
+
+    void FlushSlot(Slot& slot) {
+        if (slot.dirtyStart!=slot.dirtyEnd) {
+            m_array.SetRegion(slot.dirtyStart,slot.dirtyEnd-slot.dirtyStart,
+                slot.data+(slot.dirtyStart-slot.start));
+            slot.dirtyStart=slot.dirtyEnd=0;
+        }
+    }
+private:
+    PrimitiveArray& m_array;
+    jsize m_length;
+    Slot* m_slots;
+    Slot* m_lastSlot;
+    unsigned m_useCount;
+};
+
+///////////////////////////////////////////////// PrimitiveArray conversions
+
+template <class JType>
+template <class T>
+ObjectPointer<PrimitiveArray<JType> > PrimitiveArray<JType>::FromRange(const T* first,const T* last) {
+    ObjectPointer<PrimitiveArray> array=new PrimitiveArray(jsize(last-first));
+    array->SetRange(0,first,last);
+    return array;
+}
+
+template <class JType>
+template <class T>
+void PrimitiveArray<JType>::SetRange(jsize start,const T* first,const T* last) {
+    jsize length=jsize(last-first);
+    JType buffer[ConversionChunkLength];
+    while (length) {
+        jsize chunk=(length<jsize(ConversionChunkLength)) ? length : jsize(ConversionChunkLength);
+        ConvertElements(first,size_t(chunk),buffer);
+        SetRegion(start,chunk,buffer);
+        first+=chunk;
+        start+=chunk;
+        length-=chunk;
+    }
+}
+
+template <class JType>
+template <class T>
+void PrimitiveArray<JType>::CopyTo(jsize start,jsize length,T* out) const {
+    JType buffer[ConversionChunkLength];
+    while (length) {
+        jsize chunk=(length<jsize(ConversionChunkLength)) ? length : jsize(ConversionChunkLength);
+        GetRegion(start,chunk,buffer);
+        ConvertElements(buffer,size_t(chunk),out);
+        out+=chunk;
+        start+=chunk;
+        length-=chunk;
+    }
+}
+
+///////////////////////////////////////////////// CriticalArrays
+
+/** Pins several primitive arrays in one critical region.
+ *
+ * Arrays are added with Add() (that's when their lengths are
+ *  retrieved), then pinned all at once with Pin(). Destructor
+ *  commits changes and releases arrays in the reverse order.
+ *  The same rules as for PrimitiveArray::Critical apply.
+ * \code
+ * java::CriticalArrays arrays;
+ * size_t in=arrays.Add(*input);
+ * size_t out=arrays.Add(*output);
+ * arrays.Pin();
+ * Convolve(arrays.GetData<jfloat>(in),arrays.GetData<jfloat>(out),
+ *     arrays.GetLength(in));
+ * \endcode
+ */
+class CriticalArrays {
+public:
+    /** Maximum number of arrays.
+     */
+    static const size_t MaxArrays=8;
+
+    /** Creates empty set.
+     */
+    CriticalArrays();
+
+    /** Releases arrays (with committing).
+     */
+    ~CriticalArrays();
+
+    /** Adds \c array to the set and returns its index.
+     * Must be called before Pin().
+     */
+    template <class JType>
+    size_t Add(PrimitiveArray<JType>& array) {
+        if (!PrimitiveArray<JType>::IsCriticalSupported()) {
+            jni::FatalError("PrimitiveArray of this element type can't be pinned.");
+        }
+        return Add(array,array.GetLength());
+    }
+
+    /** Enters critical region and locks elements of all arrays.
+     */
+    void Pin();
+
+    /** Releases all arrays and leaves critical region. If \c commit
+     *  is \c false changes are discarded (\c JNI_ABORT).
+     */
+    void Release(bool commit=true);
+
+    /** Returns elements of the array at \c index.
+     */
+    template <class JType>
+    JType* GetData(size_t index) const {
+        return static_cast<JType*>(m_entries[index].elements);
+    }
+
+    /** Returns length of the array at \c index.
+     */
+    jsize GetLength(size_t index) const {
+        return m_entries[index].length;
+    }
+
+    /** Returns \c true if VM made a copy of the array at \c index.
+     */
+    bool IsCopy(size_t index) const {
+        return m_entries[index].isCopy;
+    }
+
+private:
+    CriticalArrays(const CriticalArrays&);
+    CriticalArrays& operator=(const CriticalArrays&);
+    size_t Add(const jni::AbstractObject& array,jsize length);
+    void Unpin(size_t count,jni::ArrayReleaseMode mode);
+private:
+    struct Entry {
+        const jni::AbstractObject* array;
+        jsize length;
+        void* elements;
+        bool isCopy;
+    };
+    Entry m_entries[MaxArrays];
+    size_t m_count;
+    bool m_pinned;
+};
+
 ///////////////////////////////////////////////// typedefs
 
 /** Array of booleans (\c boolean[]) which uses
@@ -162,6 +985,197 @@ typedef PrimitiveArray<jdouble> DoubleArray;
  */
 typedef ObjectPointer<DoubleArray> PDoubleArray;
 
+///////////////////////////////////////////////////////////////////// PrimitiveArrayPool
+
+/** Pool of Java primitive arrays for repeated transfers to Java.
+ *
+ * Creating new array for each transfer (e.g. per frame) allocates
+ *  Java array, wrapper and global reference each time. Pool keeps
+ *  returned arrays (by length) and hands them out again:
+ * \code
+ * static java::PrimitiveArrayPool<jfloat> g_framePool;
+ *
+ * java::PFloatArray frame=g_framePool.Checkout(FrameLength);
+ * frame->SetRegion(0,FrameLength,samples);
+ * listener->OnFrame(frame);
+ * g_framePool.Return(frame);
+ * \endcode
+ * Return array only when Java no longer uses it, otherwise Java will
+ *  see it changing.
+ *
+ * Arrays are pooled by exact length, since length of Java array is
+ *  visible to Java code. Pool is thread safe.
+ */
+template <class JType>
+class PrimitiveArrayPool {
+public:
+    typedef PrimitiveArray<JType> ArrayType;
+    typedef ObjectPointer<ArrayType> PArrayType;
+
+    /** Pool statistics.
+     */
+    struct Stats {
+        /** Number of Checkout() calls served from the pool.
+         */
+        size_t hits;
+        /** Number of Checkout() calls that created new array.
+         */
+        size_t misses;
+        /** Number of arrays dropped by Return() because pool
+         *  was full.
+         */
+        size_t drops;
+        /** Number of arrays currently in the pool.
+         */
+        size_t pooled;
+    };
+
+public:
+    /** Creates pool that keeps up to \c maxArraysPerLength arrays
+     *  of each length.
+     */
+    explicit PrimitiveArrayPool(size_t maxArraysPerLength=4):
+        m_maxArraysPerLength(maxArraysPerLength)
+    {
+        m_stats.hits=0;
+        m_stats.misses=0;
+        m_stats.drops=0;
+        m_stats.pooled=0;
+    }
+
+    /** Returns array of \c length elements, either from the pool
+     *  or newly created. Contents of pooled array is not cleared.
+     */
+    PArrayType Checkout(jsize length) {
+        {
+            pthreadpp::mutex_guard guard(m_lock);
+            typename ArrayMap::iterator found=m_arrays.find(length);
+            if (found!=m_arrays.end() && !found->second.empty()) {
+                PArrayType array=found->second.back();
+                found->second.pop_back();
+                m_stats.hits++;
+                m_stats.pooled--;
+                return array;
+            }
+            m_stats.misses++;
+        }
+        return new ArrayType(length);
+    }
+
+    /** Returns \c array to the pool. Array is dropped if pool
+     *  already has enough arrays of that length.
+     */
+    void Return(const PArrayType& array) {
+        if (!array) {
+            return;
+        }
+        jsize length=array->GetLength();
+        pthreadpp::mutex_guard guard(m_lock);
+        ArrayList& arrays=m_arrays[length];
+        if (arrays.size()>=m_maxArraysPerLength) {
+            m_stats.drops++;
+            return;
+        }
+        arrays.push_back(array);
+        m_stats.pooled++;
+    }
+
+    /** Releases all pooled arrays.
+     */
+    void Clear() {
+        ArrayMap arrays;
+        {
+            pthreadpp::mutex_guard guard(m_lock);
+            m_arrays.swap(arrays);
+            m_stats.pooled=0;
+        }
+    }
+
+    /** Returns pool statistics.
+     */
+    Stats GetStats() const {
+        pthreadpp::mutex_guard guard(m_lock);
+        return m_stats;
+    }
+
+private:
+    PrimitiveArrayPool(const PrimitiveArrayPool&);
+    PrimitiveArrayPool& operator=(const PrimitiveArrayPool&);
+private:
+    typedef std::vector<PArrayType> ArrayList;
+    typedef std::map<jsize,ArrayList> ArrayMap;
+
+    mutable pthreadpp::mutex m_lock;
+    ArrayMap m_arrays;
+    size_t m_maxArraysPerLength;
+    Stats m_stats;
+};
+
+///////////////////////////////////////////////////////////////////// ObjectArrayReader
+
+/** Streaming reader of object array elements.
+ *
+ * Reader fetches elements one by one and returns them as
+ *  jni::LocalHandle, without creating wrappers or global references.
+ *  Local references are managed in batches: a local frame is pushed
+ *  every \c batchSize elements and popped when the next batch starts
+ *  (or in destructor), so handle returned by Get() is valid only
+ *  until the next batch.
+ *
+ * Don't create LObjects between Next() calls unless they are
+ *  destroyed before the next Next() call. Use typed version
+ *  ObjectArray::Reader, which can also materialize elements.
+ */
+class ObjectArrayReader {
+public:
+    /** Default number of elements per local frame.
+     */
+    static const jsize DefaultBatchSize=64;
+
+    /** Creates reader for the \c array.
+     */
+    explicit ObjectArrayReader(const jni::AbstractObject& array,jsize batchSize=DefaultBatchSize);
+
+    /** Pops current local frame.
+     */
+    ~ObjectArrayReader();
+
+    /** Advances to the next element; returns \c false when there
+     *  are no more elements.
+     */
+    bool Next();
+
+    /** Returns current element.
+     */
+    const jni::LocalHandle& Get() const {
+        return m_element;
+    }
+
+    /** Returns index of the current element.
+     */
+    jsize GetIndex() const {
+        return m_index;
+    }
+
+    /** Returns array length.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+private:
+    ObjectArrayReader(const ObjectArrayReader&);
+    ObjectArrayReader& operator=(const ObjectArrayReader&);
+    void PopFrame();
+private:
+    const jni::AbstractObject& m_array;
+    jsize m_length;
+    jsize m_batchSize;
+    jsize m_index;
+    bool m_framePushed;
+    jni::LocalHandle m_element;
+};
+
 ///////////////////////////////////////////////////////////////////// ObjectArray
 
 /** Wrapper template for object arrays.
@@ -224,6 +1238,38 @@ public:
     void SetAt(jsize index,PObjectType pvalue) {
         jni::SetObjectArrayElement(*this,index,pvalue);
     }
+
+    /** Typed ObjectArrayReader.
+     * \code
+     * PCheckpointArray checkpoints=...;
+     * CheckpointArray::Reader reader(*checkpoints);
+     * while (reader.Next()) {
+     *     jlong time=Checkpoint::GetTime(reader.Get());
+     *     if (time>maxTime) {
+     *         maxCheckpoint=reader.Keep();
+     *     }
+     * }
+     * \endcode
+     */
+    class Reader: public ObjectArrayReader {
+    public:
+        /** Creates reader for the \c array.
+         */
+        explicit Reader(const ObjectArray& array,jsize batchSize=DefaultBatchSize):
+            ObjectArrayReader(array,batchSize)
+        {
+        }
+
+        /** Wraps current element into \c ObjectType so that
+         *  it can be used after the reader moves on.
+         */
+        PObjectType Keep() const {
+            if (Get().IsEmpty()) {
+                return PObjectType();
+            }
+            return PObjectType::Wrap(jni::LObject::Wrap(Get().GetJObject()));
+        }
+    };
 private:
     mutable jsize m_length;
     static java::Class* m_class;
@@ -234,8 +1280,8 @@ java::Class* ObjectArray<ObjectType>::m_class=0;
 
 template <class ObjectType>
 inline java::PClass ObjectArray<ObjectType>::GetTypeClass() {
-    extern java::PClass InitObjectArrayClass(java::Class*&,java::PClass);
-    return InitObjectArrayClass(m_class,ObjectType::GetTypeClass());
+    extern java::PClass InitObjectArrayClass(java::Class*&,java::PClass (*)());
+    return InitObjectArrayClass(m_class,&ObjectType::GetTypeClass);
 }
 
 ///////////////////////////////////////////////// typedefs
@@ -252,6 +1298,284 @@ typedef ObjectArray<String> StringArray;
  */
 typedef ObjectPointer<StringArray> PStringArray;
 
+///////////////////////////////////////////////////////////////////// MatrixArray
+
+/* Throws NullPointerException if \c row (with \c index) of a
+ *  matrix is null. Used by MatrixArray.
+ */
+void CheckMatrixRow(const jni::AbstractObject& row,jsize index);
+
+/** Wrapper for two-dimensional primitive arrays (like \c int[][]) that
+ *  transfers whole matrices to/from contiguous row-major storage.
+ * You don't need to use this class, use typedefs like
+ *  java::PFloatMatrixArray instead.
+ *
+ * Each row costs one element access and one region call, element
+ *  wrappers are not created:
+ * \code
+ * std::vector<jfloat> weights(rows*columns);
+ * java::PFloatMatrixArray matrix=model->GetWeights();
+ * matrix->GetData(&weights[0],columns);
+ * ...
+ * java::PFloatMatrixArray result=
+ *     java::FloatMatrixArray::FromData(&output[0],rows,columns);
+ * \endcode
+ *
+ * Rows are accessed as regions of \c columns elements, so jagged
+ *  matrices are supported only partially: rows shorter than \c columns
+ *  cause \c ArrayIndexOutOfBoundsException, and only first \c columns
+ *  elements of longer rows are read or written. \c null rows cause
+ *  \c NullPointerException. Rows processed before the exception is
+ *  thrown remain read or written.
+ */
+template <class JType>
+class MatrixArray: public ObjectArray<PrimitiveArray<JType> > {
+    JB_WRAPPER_CLASS(MatrixArray);
+    typedef ObjectArray<PrimitiveArray<JType> > Base;
+public:
+    /** Creates matrix of \c rows by \c columns zeros and wraps it.
+     */
+    MatrixArray(jsize rows,jsize columns):
+        Base(rows)
+    {
+        for (jsize row=0;row!=rows;++row) {
+            jni::SetObjectArrayElement(*this,row,PrimitiveArray<JType>::NewArray(columns));
+        }
+    }
+
+    /** Wraps \c array.
+     */
+    MatrixArray(const jni::LObject& array):
+        Base(array)
+    {
+    }
+
+    /** Creates matrix of \c rows by \c columns from row-major \c data.
+     */
+    static ObjectPointer<MatrixArray> FromData(const JType* data,jsize rows,jsize columns) {
+        ObjectPointer<MatrixArray> matrix=new MatrixArray(
+            jni::NewObjectArray(rows,PrimitiveArray<JType>::GetTypeClass()));
+        for (jsize row=0;row!=rows;++row) {
+            jni::LObject array=PrimitiveArray<JType>::NewArray(columns);
+            PrimitiveArray<JType>::SetRegion(array,0,columns,data+size_t(row)*columns);
+            jni::SetObjectArrayElement(*matrix,row,array);
+        }
+        return matrix;
+    }
+
+    /** Returns number of rows.
+     */
+    jsize GetRowCount() const {
+        return Base::GetLength();
+    }
+
+    /** Returns length of the first row (0 if matrix has no rows).
+     */
+    jsize GetColumnCount() const {
+        if (!GetRowCount()) {
+            return 0;
+        }
+        return jni::GetArrayLength(GetRowArray(0));
+    }
+
+    /** Copies first \c columns elements of the \c row to \c buffer.
+     */
+    void GetRow(jsize row,jsize columns,JType* buffer) const {
+        PrimitiveArray<JType>::GetRegion(GetRowArray(row),0,columns,buffer);
+    }
+
+    /** Updates first \c columns elements of the \c row.
+     */
+    void SetRow(jsize row,jsize columns,const JType* elements) {
+        PrimitiveArray<JType>::SetRegion(GetRowArray(row),0,columns,elements);
+    }
+
+    /** Copies matrix to row-major \c buffer which must have room
+     *  for GetRowCount()*columns elements.
+     */
+    void GetData(JType* buffer,jsize columns) const {
+        ObjectArrayReader reader(*this);
+        while (reader.Next()) {
+            CheckMatrixRow(reader.Get(),reader.GetIndex());
+            PrimitiveArray<JType>::GetRegion(reader.Get(),0,columns,
+                buffer+size_t(reader.GetIndex())*columns);
+        }
+    }
+
+    /** Updates matrix from row-major \c data.
+     */
+    void SetData(const JType* data,jsize columns) {
+        ObjectArrayReader reader(*this);
+        while (reader.Next()) {
+            CheckMatrixRow(reader.Get(),reader.GetIndex());
+            PrimitiveArray<JType>::SetRegion(reader.Get(),0,columns,
+                data+size_t(reader.GetIndex())*columns);
+        }
+    }
+
+private:
+    jni::LObject GetRowArray(jsize row) const {
+        jni::LObject array=jni::GetObjectArrayElement(*this,row);
+        CheckMatrixRow(array,row);
+        return array;
+    }
+};
+
+template <class JType>
+inline java::PClass MatrixArray<JType>::GetTypeClass() {
+    return Base::GetTypeClass();
+}
+
+///////////////////////////////////////////////// typedefs
+
+/** Matrix of bytes (\c byte[][]).
+ */
+typedef MatrixArray<jbyte> ByteMatrixArray;
+/** Pointer to ByteMatrixArray.
+ */
+typedef ObjectPointer<ByteMatrixArray> PByteMatrixArray;
+
+
+/** Matrix of short integers (\c short[][]).
+ */
+typedef MatrixArray<jshort> ShortMatrixArray;
+/** Pointer to ShortMatrixArray.
+ */
+typedef ObjectPointer<ShortMatrixArray> PShortMatrixArray;
+
+
+/** Matrix of integers (\c int[][]).
+ */
+typedef MatrixArray<jint> IntMatrixArray;
+/** Pointer to IntMatrixArray.
+ */
+typedef ObjectPointer<IntMatrixArray> PIntMatrixArray;
+
+
+/** Matrix of long integers (\c long[][]).
+ */
+typedef MatrixArray<jlong> LongMatrixArray;
+/** Pointer to LongMatrixArray.
+ */
+typedef ObjectPointer<LongMatrixArray> PLongMatrixArray;
+
+
+/** Matrix of floats (\c float[][]).
+ */
+typedef MatrixArray<jfloat> FloatMatrixArray;
+/** Pointer to FloatMatrixArray.
+ */
+typedef ObjectPointer<FloatMatrixArray> PFloatMatrixArray;
+
+
+/** Matrix of doubles (\c double[][]).
+ */
+typedef MatrixArray<jdouble> DoubleMatrixArray;
+/** Pointer to DoubleMatrixArray.
+ */
+typedef ObjectPointer<DoubleMatrixArray> PDoubleMatrixArray;
+
+///////////////////////////////////////////////////////////////////// UTFStringArena
+
+/** Contiguous storage for a list of UTF-8 strings.
+ *
+ * All strings are kept in a single buffer, each one followed by
+ *  a zero byte, so converting an array of thousands of strings
+ *  costs a few allocations instead of thousands. Strings are in
+ *  standard UTF-8 (see String::ToUTF8()) and may contain NULs,
+ *  use GetLengthAt() to get their real length.
+ *
+ * Use GetStrings() to fill the arena from a StringArray and
+ *  NewStringArray() to convert it back:
+ * \code
+ * java::UTFStringArena strings;
+ * java::GetStrings(*array,strings);
+ * for (size_t i=0;i!=strings.GetCount();++i) {
+ *     printf("%s\n",strings.GetAt(i));
+ * }
+ * \endcode
+ */
+class UTFStringArena {
+public:
+    /** Creates empty arena.
+     */
+    UTFStringArena();
+
+    /** Returns number of strings.
+     */
+    size_t GetCount() const {
+        return m_entries.size();
+    }
+
+    /** Returns zero-terminated string at \c index or NULL if
+     *  it's a null string.
+     * Pointer is valid until the arena is modified.
+     */
+    const char* GetAt(size_t index) const {
+        size_t offset=m_entries[index].offset;
+        return (offset==NullOffset) ? 0 : &m_data[offset];
+    }
+
+    /** Returns length (in bytes) of the string at \c index.
+     */
+    size_t GetLengthAt(size_t index) const {
+        return m_entries[index].length;
+    }
+
+    /** Removes all strings (memory is kept for reuse).
+     */
+    void Clear();
+
+    /** Reserves memory for \c count strings of \c dataSize bytes
+     *  in total.
+     */
+    void Reserve(size_t count,size_t dataSize);
+
+    /** Appends \c length bytes of the \c string.
+     */
+    void Append(const char* string,size_t length);
+
+    /** Appends null string.
+     */
+    void AppendNull();
+
+    /** Appends uninitialized string of \c length bytes and returns
+     *  pointer to its first byte.
+     * Pointer is valid until the arena is modified.
+     */
+    char* AppendUninitialized(size_t length);
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t length;
+    };
+    static const size_t NullOffset=size_t(-1);
+private:
+    std::vector<char> m_data;
+    std::vector<Entry> m_entries;
+};
+
+/** Converts all strings of the \c array to UTF-8 and appends them
+ *  to the \c strings.
+ * Elements are read in batches, each batch within its own local
+ *  reference frame; no wrappers or global references are created.
+ */
+void GetStrings(const StringArray& array,UTFStringArena& strings);
+
+/** Creates \c String[] from the \c strings.
+ */
+PStringArray NewStringArray(const UTFStringArena& strings);
+
+/** Creates \c String[] from the \c strings.
+ */
+PStringArray NewStringArray(const std::vector<std::string>& strings);
+
+/** Creates \c String[] from \c count UTF-8 \c strings with the
+ *  specified \c lengths. NULL pointers become null elements.
+ */
+PStringArray NewStringArray(const char* const* strings,const size_t* lengths,size_t count);
+
 /////////////////////////////////////////////////////////////////////
 
 END_NAMESPACE(java)
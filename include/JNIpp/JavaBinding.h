@@ -23,6 +23,7 @@
 
 #include <pthread.h>
 #include <limits.h>
+#include <vector>
 #include <dropins/begin_namespace.h>
 #include "JavaNI.h"
 #include "JavaObjectPointer.h"
@@ -172,6 +173,11 @@ BEGIN_NAMESPACE(jb)
  *    It doesn'tinclude any type or signature information.
  *    To indicate a static field or method start name with a
  *    plus sign (e.g. \c "+myStaticField", \c "+myStaticMethod").
+ *    To indicate a constant (<tt>static final</tt>) field start
+ *    name with an equals sign (e.g. \c "=MY_CONSTANT"). Values of
+ *    constant fields are read once when class is initialized and
+ *    JB_GET_STATIC() returns them without calling Java. Constant
+ *    fields must not be changed.
  * - \c Descriptor is field/method descriptor.
  *    See 12.3.3 "Field Descriptors" or 12.3.4 "Method Descriptors"
  *    in JNI specification.
@@ -212,13 +218,46 @@ BEGIN_NAMESPACE(jb)
 
 #ifndef JB_NATIVE_INSTANCE_NAME
 
-/** Name of the \p int variable in Java class that holds
- *  instance pointer; default is \c nativeInstance.
+/** Name of the variable in Java class that holds instance
+ *  pointer; default is \c nativeInstance.
+ * The variable is \p int unless JNIPP_NATIVE_INSTANCE_LONG
+ *  is defined.
  */
 #define JB_NATIVE_INSTANCE_NAME "nativeInstance"
 
 #endif
 
+#ifdef ONLY_FOR_DOXYGEN
+
+/** Define to store instance pointers in \p long variables,
+ *  so live classes work on 64-bit hosts. Java classes must then
+ *  declare <tt> private long nativeInstance; </tt>
+ * Required on 64-bit hosts, compilation fails without it.
+ *
+ * This must be defined for both JNIpp and your code (e.g. in
+ *  \c APP_CPPFLAGS).
+ */
+#define JNIPP_NATIVE_INSTANCE_LONG
+
+/** Define to store handles instead of pointers in \p long instance
+ *  variables (implies JNIPP_NATIVE_INSTANCE_LONG).
+ * Handle is an index into a global table plus generation number,
+ *  so a handle that outlived its object is detected without
+ *  dereferencing anything and resolves to NULL.
+ */
+#define JNIPP_NATIVE_INSTANCE_HANDLES
+
+#endif // ONLY_FOR_DOXYGEN
+
+#if defined(JNIPP_NATIVE_INSTANCE_HANDLES) && !defined(JNIPP_NATIVE_INSTANCE_LONG)
+#define JNIPP_NATIVE_INSTANCE_LONG
+#endif
+
+/* Pointers don't fit into 'int' fields on 64-bit hosts. */
+#if !defined(JNIPP_NATIVE_INSTANCE_LONG) && (defined(__LP64__) || defined(_WIN64))
+#error "Define JNIPP_NATIVE_INSTANCE_LONG (or JNIPP_NATIVE_INSTANCE_HANDLES) on 64-bit hosts."
+#endif
+
 
 /** Defines Java bindings for the current live class.
  *
@@ -478,12 +517,15 @@ BEGIN_NAMESPACE(jb)
 /** Retrieves value from the static field identified by \c FieldTag.
  * See JB_GET() for \c WhichField values.
  *
- * This macro expands to \c jni::GetStatic##WhichField(object).
+ * For constant fields (see JB_DEFINE_WRAPPER_CLASS()) returns cached
+ *  value; \c ObjectField values are returned as new local references
+ *  to the cached object. For other fields calls
+ *  \c jni::GetStatic##WhichField().
  */
 #define JB_GET_STATIC(WhichField,FieldTag) \
-    jni::GetStatic##WhichField( \
-        *JB_GET_CLASS(), \
-        JB_GET_FIELD_ID(FieldTag))
+    ::jb::GetStatic##WhichField( \
+        xJB_GET_FIELD(xJB_FIELD_INDICES::FieldTag), \
+        &xJB_GET_CLASS)
 
 
 /** Sets value to the static field identified by \c FieldTag.
@@ -496,6 +538,141 @@ BEGIN_NAMESPACE(jb)
         *JB_GET_CLASS(), \
         JB_GET_FIELD_ID(FieldTag),value)
 
+
+/** Creates jb::Field accessor for the instance field identified by
+ *  \c FieldTag. \c Type must match type of the field (see jb::Field
+ *  for supported types), this is checked when accessor is created.
+ *
+ * Accessors are meant to be created once and then reused:
+ * \code
+ * static const jb::Field<jlong> timeField=JB_FIELD(jlong,TimeTag);
+ * jlong time=timeField(object);
+ * \endcode
+ */
+#define JB_FIELD(Type,FieldTag) \
+    ::jb::MakeField<Type>( \
+        xJB_G_FIELDS[xJB_FIELD_INDICES::FieldTag], \
+        JB_GET_FIELD_ID(FieldTag))
+
+
+/** Creates jb::StaticField accessor for the static field identified
+ *  by \c FieldTag. See JB_FIELD().
+ */
+#define JB_STATIC_FIELD(Type,FieldTag) \
+    ::jb::MakeStaticField<Type>( \
+        xJB_G_FIELDS[xJB_FIELD_INDICES::FieldTag], \
+        (jclass)JB_GET_CLASS()->GetJObject(), \
+        JB_GET_FIELD_ID(FieldTag))
+
+
+/** Defines mapping between members of C++ struct \c StructType and
+ *  fields of the current class.
+ *
+ * Mapped structs are read and written as a whole with JB_READ_STRUCT()
+ *  and JB_WRITE_STRUCT(), or for every element of an object array with
+ *  JB_READ_STRUCTS() and JB_WRITE_STRUCTS(). This is much faster than
+ *  accessing fields one by one with JB_GET() when lots of objects
+ *  need to be processed.
+ *
+ * \c StructType must be an unqualified name (use typedef if needed).
+ *
+ * \c MembersSpec is identifier \c Members followed by a number of
+ *  member specs of form (\c Member, \c FieldTag), where \c Member is
+ *  name of a member of \c StructType and \c FieldTag is a tag from
+ *  \c FieldsSpec of the current class (see JB_DEFINE_WRAPPER_CLASS()).
+ *  Static fields can't be mapped.
+ *
+ * Members can be of primitive JNI types (\c jint, \c jfloat, etc.),
+ *  \c bool or jni::LObject (for object and array fields). Member types
+ *  are checked against field descriptors on first use.
+ *
+ * \code
+ * *** Java ***
+ * class Particle {
+ *   float x,y;
+ *   int color;
+ * }
+ *
+ * *** C++ ***
+ * struct ParticleData {
+ *   jfloat x,y;
+ *   jint color;
+ * };
+ *
+ * JB_DEFINE_ACCESSOR(
+ *   "com/my/Particle"
+ *   ,
+ *   Fields
+ *   (X,"x","F")
+ *   (Y,"y","F")
+ *   (Color,"color","I")
+ *   ,
+ *   NoMethods
+ * )
+ *
+ * JB_DEFINE_STRUCT(
+ *   ParticleData
+ *   ,
+ *   Members
+ *   (x,X)
+ *   (y,Y)
+ *   (color,Color)
+ * )
+ *
+ * std::vector<ParticleData> particles;
+ * JB_READ_STRUCTS(ParticleData,*particleArray,particles);
+ * \endcode
+ */
+#define JB_DEFINE_STRUCT(StructType,MembersSpec) \
+    xJB_DEFINE_STRUCT(StructType,MembersSpec)
+
+
+/** Reads all mapped fields of \c object to \c value of type
+ *  \c StructType (see JB_DEFINE_STRUCT()).
+ *
+ * Throws \c NullPointerException if \c object is \c null.
+ */
+#define JB_READ_STRUCT(StructType,object,value) \
+    ::jb::ReadStruct(xJB_G_STRUCT(StructType),object,value)
+
+
+/** Writes \c value of type \c StructType to mapped fields of
+ *  \c object (see JB_DEFINE_STRUCT()).
+ */
+#define JB_WRITE_STRUCT(StructType,object,value) \
+    ::jb::WriteStruct(xJB_G_STRUCT(StructType),object,value)
+
+
+/** Reads elements of object \c array to structs of type \c StructType
+ *  (see JB_DEFINE_STRUCT()).
+ *
+ * Can be used in two forms:
+ * - <tt> JB_READ_STRUCTS(StructType,array,values) </tt>, where \c values
+ *    is <tt> std::vector<StructType> </tt>. Reads the whole array.
+ * - <tt> JB_READ_STRUCTS(StructType,array,start,length,values) </tt>,
+ *    where \c values is <tt> StructType* </tt>.
+ *
+ * Throws \c NullPointerException if an element is \c null and
+ *  \c ArrayIndexOutOfBoundsException if the range is invalid.
+ *
+ * Elements are accessed without creating wrappers. Note that each
+ *  jni::LObject member holds a local reference, so use local frames
+ *  (jni::PushLocalFrame()) when reading large arrays of such structs.
+ */
+#define JB_READ_STRUCTS(StructType,array,...) \
+    ::jb::ReadStructs(xJB_G_STRUCT(StructType),array,__VA_ARGS__)
+
+
+/** Writes structs of type \c StructType to elements of object
+ *  \c array (see JB_DEFINE_STRUCT()).
+ *
+ * Forms are the same as for JB_READ_STRUCTS(), except that the
+ *  array is not resized: <tt> std::vector<StructType> </tt> version
+ *  writes \c values.size() elements.
+ */
+#define JB_WRITE_STRUCTS(StructType,array,...) \
+    ::jb::WriteStructs(xJB_G_STRUCT(StructType),array,__VA_ARGS__)
+
 ///////////////////////////////////////////////////////////////////// implementation
 
 ///////////////////////////////////////////////// java::Class
@@ -585,8 +762,13 @@ BEGIN_NAMESPACE(jb)
 
 #define xJB_INSTANCE_FIELD \
     InstanceField
+#ifdef JNIPP_NATIVE_INSTANCE_LONG
+#define xJB_INSTANCE_FIELD_SIGNATURE "J"
+#else
+#define xJB_INSTANCE_FIELD_SIGNATURE "I"
+#endif
 #define xJB_INSTANCE_FIELD_DECLARATION \
-    (xJB_INSTANCE_FIELD,JB_NATIVE_INSTANCE_NAME,"I")
+    (xJB_INSTANCE_FIELD,JB_NATIVE_INSTANCE_NAME,xJB_INSTANCE_FIELD_SIGNATURE)
 #define xJB_ADD_INSTANCE_FIELD(Fields) \
     xJB_EVAL(xJB_ADD_INSTANCE_FIELD_##Fields)
 #define xJB_ADD_INSTANCE_FIELD_NoFields \
@@ -602,6 +784,62 @@ BEGIN_NAMESPACE(jb)
         return xJB_G_FIELDS[index].id; \
     }
 
+#define xJB_GET_FIELD \
+    xJB_JOIN3(JBGet,JB_CURRENT_CLASS,Field)
+#define xJB_IMPLEMENT_GET_FIELD() \
+    static const ::jb::FieldDescriptor& xJB_GET_FIELD(int index) { \
+        xJB_INIT_CLASS(); \
+        return xJB_G_FIELDS[index]; \
+    }
+
+///////////////////////////////////////////////// struct mappings
+
+#define xJB_G_STRUCT(StructType) \
+    xJB_JOIN3(g_jb,JB_CURRENT_CLASS,xJB_JOIN(StructType,Struct))
+
+#define xJB_STRUCT_MEMBERS(StructType) \
+    xJB_JOIN3(JB,JB_CURRENT_CLASS,xJB_JOIN(StructType,StructMembers))
+
+/* Member table is defined as a static member of a helper struct, so
+ *  that 'Struct' typedef is visible in member specs.
+ */
+#define xJB_DEFINE_STRUCT(StructType,MembersSpec) \
+    namespace { \
+    struct xJB_STRUCT_MEMBERS(StructType) { \
+        typedef StructType Struct; \
+        static const ::jb::StructMemberDescriptor Descriptors[]; \
+    }; \
+    const ::jb::StructMemberDescriptor xJB_STRUCT_MEMBERS(StructType)::Descriptors[]={ \
+        xJB_END(xJB_JOIN(xJB_PUT_STRUCT_MEMBER_,MembersSpec)) \
+        {0} \
+    }; \
+    static ::jb::StructMapping<StructType> xJB_G_STRUCT(StructType)={{ \
+        #StructType, \
+        xJB_G_FIELDS, \
+        &xJB_GET_FIELD_ID, \
+        xJB_STRUCT_MEMBERS(StructType)::Descriptors \
+    }}; \
+    }
+
+#define xJB_STRUCT_MEMBER(Member) \
+    ::jb::StructMember<Struct,__typeof__(((Struct*)0)->Member),&Struct::Member>
+
+#define xJB_PUT_STRUCT_MEMBER(Member,FieldTag) \
+    { \
+        &xJB_STRUCT_MEMBER(Member)::Read, \
+        &xJB_STRUCT_MEMBER(Member)::Write, \
+        xJB_FIELD_INDICES::FieldTag, \
+        xJB_STRUCT_MEMBER(Member)::Signature \
+    },
+#define xJB_PUT_STRUCT_MEMBER_Members(...) \
+    xJB_PUT_STRUCT_MEMBER(__VA_ARGS__)xJB_PUT_STRUCT_MEMBER_0_
+#define xJB_PUT_STRUCT_MEMBER_0_(...) \
+    xJB_PUT_STRUCT_MEMBER(__VA_ARGS__)xJB_PUT_STRUCT_MEMBER_1_
+#define xJB_PUT_STRUCT_MEMBER_1_(...) \
+    xJB_PUT_STRUCT_MEMBER(__VA_ARGS__)xJB_PUT_STRUCT_MEMBER_0_
+#define xJB_PUT_STRUCT_MEMBER_0_END
+#define xJB_PUT_STRUCT_MEMBER_1_END
+
 ///////////////////////////////////////////////// callbacks
 
 #define xJB_IMPLEMENT_FINALIZE() \
@@ -693,6 +931,7 @@ BEGIN_NAMESPACE(jb)
     xJB_IMPLEMENT_GET_CLASS(); \
     xJB_IMPLEMENT_GET_METHOD_ID(); \
     xJB_IMPLEMENT_GET_FIELD_ID(); \
+    xJB_IMPLEMENT_GET_FIELD(); \
     }
 
 #define xJB_INIT_CLASS() \
@@ -789,10 +1028,454 @@ struct FieldDescriptor {
     const char* name;
     const char* signature;
     jfieldID id;
+
+    // Value of a constant field; 'l' is a global reference.
+    bool isConstant;
+    jvalue value;
 };
 
 void InitClassDescriptor(ClassDescriptor& descriptor);
 
+///////////////////////////////////////////////// static fields
+
+/* Implementation of JB_GET_STATIC(). Templates are used to defer
+ *  conversion of java::Class to jni::AbstractObject, because
+ *  java::Class is incomplete here.
+ */
+
+#define xJB_DEFINE_GET_STATIC(WhichField,ValueType,Member) \
+    template <class ClassType> \
+    inline ValueType GetStatic##WhichField(const FieldDescriptor& field,ClassType* (*getClass)()) { \
+        if (field.isConstant) { \
+            return field.value.Member; \
+        } \
+        return jni::GetStatic##WhichField(*getClass(),field.id); \
+    }
+
+xJB_DEFINE_GET_STATIC(BooleanField,jboolean,z)
+xJB_DEFINE_GET_STATIC(ByteField,jbyte,b)
+xJB_DEFINE_GET_STATIC(CharField,jchar,c)
+xJB_DEFINE_GET_STATIC(ShortField,jshort,s)
+xJB_DEFINE_GET_STATIC(IntField,jint,i)
+xJB_DEFINE_GET_STATIC(LongField,jlong,j)
+xJB_DEFINE_GET_STATIC(FloatField,jfloat,f)
+xJB_DEFINE_GET_STATIC(DoubleField,jdouble,d)
+
+#undef xJB_DEFINE_GET_STATIC
+
+template <class ClassType>
+inline bool GetStaticBoolField(const FieldDescriptor& field,ClassType* (*getClass)()) {
+    if (field.isConstant) {
+        return field.value.z!=JNI_FALSE;
+    }
+    return jni::GetStaticBoolField(*getClass(),field.id);
+}
+
+template <class ClassType>
+inline jni::LObject GetStaticObjectField(const FieldDescriptor& field,ClassType* (*getClass)()) {
+    if (field.isConstant) {
+        return jni::LObject::Wrap(field.value.l);
+    }
+    return jni::GetStaticObjectField(*getClass(),field.id);
+}
+
+///////////////////////////////////////////////// field traits
+
+/* FieldTraits<T> reads and writes fields of Java type that
+ *  corresponds to T.
+ */
+template <class T>
+struct FieldTraits;
+
+#define xJB_DEFINE_FIELD_TRAITS(Type,TypeSignature,Name) \
+    template <> \
+    struct FieldTraits<Type> { \
+        static const char Signature=TypeSignature; \
+        static Type Get(JNIEnv* env,jobject object,jfieldID fieldID) { \
+            return env->Get##Name##Field(object,fieldID); \
+        } \
+        static void Set(JNIEnv* env,jobject object,jfieldID fieldID,Type value) { \
+            env->Set##Name##Field(object,fieldID,value); \
+        } \
+        static Type GetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID) { \
+            return env->GetStatic##Name##Field(clazz,fieldID); \
+        } \
+        static void SetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID,Type value) { \
+            env->SetStatic##Name##Field(clazz,fieldID,value); \
+        } \
+    };
+
+xJB_DEFINE_FIELD_TRAITS(jboolean,'Z',Boolean)
+xJB_DEFINE_FIELD_TRAITS(jbyte,'B',Byte)
+xJB_DEFINE_FIELD_TRAITS(jchar,'C',Char)
+xJB_DEFINE_FIELD_TRAITS(jshort,'S',Short)
+xJB_DEFINE_FIELD_TRAITS(jint,'I',Int)
+xJB_DEFINE_FIELD_TRAITS(jlong,'J',Long)
+xJB_DEFINE_FIELD_TRAITS(jfloat,'F',Float)
+xJB_DEFINE_FIELD_TRAITS(jdouble,'D',Double)
+
+#undef xJB_DEFINE_FIELD_TRAITS
+
+template <>
+struct FieldTraits<bool> {
+    static const char Signature='Z';
+    static bool Get(JNIEnv* env,jobject object,jfieldID fieldID) {
+        return env->GetBooleanField(object,fieldID)!=JNI_FALSE;
+    }
+    static void Set(JNIEnv* env,jobject object,jfieldID fieldID,bool value) {
+        env->SetBooleanField(object,fieldID,value ? JNI_TRUE : JNI_FALSE);
+    }
+    static bool GetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID) {
+        return env->GetStaticBooleanField(clazz,fieldID)!=JNI_FALSE;
+    }
+    static void SetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID,bool value) {
+        env->SetStaticBooleanField(clazz,fieldID,value ? JNI_TRUE : JNI_FALSE);
+    }
+};
+
+template <>
+struct FieldTraits<jni::LObject> {
+    static const char Signature='L';
+    static jni::LObject Get(JNIEnv* env,jobject object,jfieldID fieldID) {
+        return jni::LObject::WrapLocal(env->GetObjectField(object,fieldID));
+    }
+    static void Set(JNIEnv* env,jobject object,jfieldID fieldID,const jni::LObject& value) {
+        env->SetObjectField(object,fieldID,value.GetJObject());
+    }
+    static jni::LObject GetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID) {
+        return jni::LObject::WrapLocal(env->GetStaticObjectField(clazz,fieldID));
+    }
+    static void SetStatic(JNIEnv* env,jclass clazz,jfieldID fieldID,const jni::LObject& value) {
+        env->SetStaticObjectField(clazz,fieldID,value.GetJObject());
+    }
+};
+
+/* Moves value without copying local references. */
+template <class T>
+inline void MoveFieldValue(T& to,T& from) {
+    to=from;
+}
+
+inline void MoveFieldValue(jni::LObject& to,jni::LObject& from) {
+    to.Swap(from);
+}
+
+///////////////////////////////////////////////// struct descriptors
+
+struct StructMemberDescriptor {
+    void (*read)(JNIEnv* env,jobject object,jfieldID fieldID,void* value);
+    void (*write)(JNIEnv* env,jobject object,jfieldID fieldID,const void* value);
+    int fieldIndex;
+    char signature;
+};
+
+struct StructDescriptor {
+    // Statically initialized.
+    const char* structName;
+    FieldDescriptor* fields;
+    jfieldID (*getFieldID)(int index);
+    const StructMemberDescriptor* members;
+
+    // Initialized in runtime.
+    volatile bool isVerified;
+};
+
+/* Typed wrapper, so that JB_READ_STRUCT() and friends can check
+ *  struct type.
+ */
+template <class Struct>
+struct StructMapping {
+    StructDescriptor descriptor;
+};
+
+void ReadStruct(StructDescriptor& descriptor,const jni::AbstractObject& object,void* value);
+void WriteStruct(StructDescriptor& descriptor,const jni::AbstractObject& object,const void* value);
+void ReadStructs(StructDescriptor& descriptor,const jni::AbstractObject& array,
+                 jsize start,jsize length,void* values,size_t stride);
+void WriteStructs(StructDescriptor& descriptor,const jni::AbstractObject& array,
+                  jsize start,jsize length,const void* values,size_t stride);
+
+template <class Struct>
+inline void ReadStruct(StructMapping<Struct>& mapping,const jni::AbstractObject& object,Struct& value) {
+    ReadStruct(mapping.descriptor,object,&value);
+}
+
+template <class Struct>
+inline void WriteStruct(StructMapping<Struct>& mapping,const jni::AbstractObject& object,const Struct& value) {
+    WriteStruct(mapping.descriptor,object,&value);
+}
+
+template <class Struct>
+inline void ReadStructs(StructMapping<Struct>& mapping,const jni::AbstractObject& array,
+                        jsize start,jsize length,Struct* values)
+{
+    ReadStructs(mapping.descriptor,array,start,length,values,sizeof(Struct));
+}
+
+template <class Struct>
+inline void ReadStructs(StructMapping<Struct>& mapping,const jni::AbstractObject& array,
+                        std::vector<Struct>& values)
+{
+    values.resize(size_t(jni::GetArrayLength(array)));
+    if (!values.empty()) {
+        ReadStructs(mapping.descriptor,array,0,jsize(values.size()),&values[0],sizeof(Struct));
+    }
+}
+
+template <class Struct>
+inline void WriteStructs(StructMapping<Struct>& mapping,const jni::AbstractObject& array,
+                         jsize start,jsize length,const Struct* values)
+{
+    WriteStructs(mapping.descriptor,array,start,length,values,sizeof(Struct));
+}
+
+template <class Struct>
+inline void WriteStructs(StructMapping<Struct>& mapping,const jni::AbstractObject& array,
+                         const std::vector<Struct>& values)
+{
+    if (!values.empty()) {
+        WriteStructs(mapping.descriptor,array,0,jsize(values.size()),&values[0],sizeof(Struct));
+    }
+}
+
+template <class Struct,class T,T Struct::*Member>
+struct StructMember {
+    static const char Signature=FieldTraits<T>::Signature;
+    static void Read(JNIEnv* env,jobject object,jfieldID fieldID,void* value) {
+        T fieldValue=FieldTraits<T>::Get(env,object,fieldID);
+        MoveFieldValue(static_cast<Struct*>(value)->*Member,fieldValue);
+    }
+    static void Write(JNIEnv* env,jobject object,jfieldID fieldID,const void* value) {
+        FieldTraits<T>::Set(env,object,fieldID,static_cast<const Struct*>(value)->*Member);
+    }
+};
+
+///////////////////////////////////////////////// field accessors
+
+/* Checks that field described by \c descriptor is (or is not)
+ *  static and has type compatible with \c signature. Errors name
+ *  \c structName if it's not NULL.
+ */
+void CheckFieldType(const FieldDescriptor& descriptor,char signature,bool isStatic,
+                    const char* structName=0);
+
+template <class T>
+class Field;
+
+template <class T>
+class StaticField;
+
+template <class T>
+inline Field<T> MakeField(const FieldDescriptor& descriptor,jfieldID fieldID) {
+    CheckFieldType(descriptor,FieldTraits<T>::Signature,false);
+    return Field<T>(fieldID);
+}
+
+template <class T>
+inline StaticField<T> MakeStaticField(const FieldDescriptor& descriptor,jclass clazz,jfieldID fieldID) {
+    CheckFieldType(descriptor,FieldTraits<T>::Signature,true);
+    return StaticField<T>(clazz,fieldID);
+}
+
+/** Typed accessor for an instance field.
+ *
+ * Holds resolved field ID, so accessing a field costs the same
+ *  as calling \c JNIEnv::Get/Set\<Type\>Field directly. Use JB_FIELD()
+ *  to create accessors for fields of the current class.
+ *
+ * \c T is a primitive JNI type (\c jint, \c jfloat, etc.), \c bool
+ *  or jni::LObject.
+ *
+ * \code
+ * static jb::Field<jfloat> speedField=JB_FIELD(jfloat,SpeedTag);
+ * for (...) {
+ *   speedField(object,speedField(object)*factor);
+ * }
+ * \endcode
+ * Overloads that take \c JNIEnv* and \c jobject avoid thread-local
+ *  lookup of JNIEnv and are meant for tight loops.
+ */
+template <class T>
+class Field {
+public:
+
+    /** Constructs empty accessor.
+     */
+    Field():
+        m_fieldID(0)
+    {
+    }
+
+    /** Constructs accessor for \c fieldID. Field type is not
+     *  checked.
+     */
+    explicit Field(jfieldID fieldID):
+        m_fieldID(fieldID)
+    {
+    }
+
+    /** Returns field ID.
+     */
+    jfieldID GetID() const {
+        return m_fieldID;
+    }
+
+    /** Returns field value of \c object.
+     */
+    T Get(JNIEnv* env,jobject object) const {
+        return FieldTraits<T>::Get(env,object,m_fieldID);
+    }
+
+    /** Returns field value of \c object.
+     */
+    T Get(const jni::AbstractObject& object) const {
+        return FieldTraits<T>::Get(jni::GetEnv(),object.GetJObject(),m_fieldID);
+    }
+
+    /** Sets field value of \c object.
+     */
+    void Set(JNIEnv* env,jobject object,const T& value) const {
+        FieldTraits<T>::Set(env,object,m_fieldID,value);
+    }
+
+    /** Sets field value of \c object.
+     */
+    void Set(const jni::AbstractObject& object,const T& value) const {
+        FieldTraits<T>::Set(jni::GetEnv(),object.GetJObject(),m_fieldID,value);
+    }
+
+    /** Same as Get().
+     */
+    T operator()(const jni::AbstractObject& object) const {
+        return Get(object);
+    }
+
+    /** Same as Set().
+     */
+    void operator()(const jni::AbstractObject& object,const T& value) const {
+        Set(object,value);
+    }
+
+private:
+    jfieldID m_fieldID;
+};
+
+/** Typed accessor for a static field.
+ *
+ * Same as Field, but also holds the class. Use JB_STATIC_FIELD() to
+ *  create accessors for static fields of the current class.
+ */
+template <class T>
+class StaticField {
+public:
+
+    /** Constructs empty accessor.
+     */
+    StaticField():
+        m_class(0),
+        m_fieldID(0)
+    {
+    }
+
+    /** Constructs accessor for \c fieldID of \c clazz, which must
+     *  be a global reference that outlives the accessor. Field type
+     *  is not checked.
+     */
+    StaticField(jclass clazz,jfieldID fieldID):
+        m_class(clazz),
+        m_fieldID(fieldID)
+    {
+    }
+
+    /** Returns field ID.
+     */
+    jfieldID GetID() const {
+        return m_fieldID;
+    }
+
+    /** Returns field value.
+     */
+    T Get(JNIEnv* env) const {
+        return FieldTraits<T>::GetStatic(env,m_class,m_fieldID);
+    }
+
+    /** Returns field value.
+     */
+    T Get() const {
+        return Get(jni::GetEnv());
+    }
+
+    /** Sets field value.
+     */
+    void Set(JNIEnv* env,const T& value) const {
+        FieldTraits<T>::SetStatic(env,m_class,m_fieldID,value);
+    }
+
+    /** Sets field value.
+     */
+    void Set(const T& value) const {
+        Set(jni::GetEnv(),value);
+    }
+
+    /** Same as Get().
+     */
+    T operator()() const {
+        return Get();
+    }
+
+    /** Same as Set().
+     */
+    void operator()(const T& value) const {
+        Set(value);
+    }
+
+private:
+    jclass m_class;
+    jfieldID m_fieldID;
+};
+
+///////////////////////////////////////////////// native factories
+
+/** Function that creates native instance for a Java \c object.
+ */
+typedef void (*NativeFactoryFunction)(const jni::LObject& object);
+
+/** Default factory: creates \c T from Java \c object.
+ * Native instances of live classes are owned by their Java objects,
+ *  so the result is not returned. If \c T has private constructor
+ *  declare <tt>friend class jb::NativeFactory<T>;</tt>.
+ */
+template <class T>
+struct NativeFactory {
+    static void Create(const jni::LObject& object) {
+        new T(object);
+    }
+};
+
+/** Registers \c factory for \c name (usually full name of a Java
+ *  class, e.g. \c "com.my.MainActivity").
+ * Registering the same name again replaces the factory.
+ * Safe to call from static initializers of other translation units.
+ */
+void RegisterNativeFactory(const char* name,NativeFactoryFunction factory);
+
+/** Registers NativeFactory<T> for \c name.
+ * \code
+ * jb::RegisterNativeFactory<MainActivity>("com.my.MainActivity");
+ * \endcode
+ */
+template <class T>
+inline void RegisterNativeFactory(const char* name) {
+    RegisterNativeFactory(name,&NativeFactory<T>::Create);
+}
+
+/** Creates native instance for \c object using factory registered
+ *  for \c name. Returns \c false if there is no such factory.
+ * Lookup is a hash table search, so it doesn't depend on number of
+ *  registered factories.
+ */
+bool CreateNativeInstance(const char* name,const jni::LObject& object);
+
 ///////////////////////////////////////////////////////////////////// ConvertCC
 
 /* Everything below are implementation details of ConvertCC
@@ -22,11 +22,11 @@
 #ifndef _JNIPP_JAVALANG_INCLUDED_
 #define _JNIPP_JAVALANG_INCLUDED_
 
+#include <string>
 #include <dropins/pthreadpp.h>
 #include "JavaObject.h"
 
 //TODO cache length/utfLength in java::String.
-//TODO add all JNIEnv functions that java::String to #jni.
 
 /** Contains java::Object and basic wrapper classes.
  */
@@ -114,10 +114,30 @@ typedef java::ObjectPointer<String> PString;
 
 
 /** Wrapper for \c java.lang.String.
+ *
+ * Get() and GetUTF() cache native copies of the string. How long the
+ *  copies are kept is controlled by the cache policy (see CachePolicy).
+ *  Short strings are cached inside the wrapper itself, longer ones are
+ *  allocated on the heap and accounted in GetCachedBytes().
  */
 class String: public CharSequence {
     JB_WRAPPER_CLASS(String);
 public:
+    /** Determines which native copies of the string are cached.
+     */
+    enum CachePolicy {
+        /** Both Get() and GetUTF() results are kept until the wrapper
+         *  is destroyed or DropCaches() is called. This is the default.
+         */
+        CacheAll,
+
+        /** Only the last requested representation is kept: calling
+         *  Get() drops GetUTF() result and vice versa. Pointers are
+         *  valid until the next Get(), GetUTF() or DropCaches() call.
+         */
+        CacheLast
+    };
+
     /** Creates empty \c java.lang.String and wraps it.
      */
     String();
@@ -162,22 +182,265 @@ public:
      */
     const char* GetUTF() const;
 
+    /** Copies \c length unicode characters starting at \c start
+     *  to the \c buffer.
+     * Nothing is cached, use this method (or StringCharsView) to
+     *  read large strings without keeping copies around.
+     */
+    void GetRegion(jsize start,jsize length,jchar* buffer) const;
+
+    /** Converts \c length unicode characters starting at \c start
+     *  to modified UTF-8 and stores them in the \c buffer.
+     * See jni::GetStringUTFRegion() for buffer size requirements.
+     */
+    void GetUTFRegion(jsize start,jsize length,char* buffer) const;
+
+    /** Creates \c java.lang.String from \c length bytes of standard
+     *  UTF-8 and wraps it.
+     * Unlike String(const char*) supplementary characters (emoji, etc.)
+     *  may be encoded as 4-byte sequences and embedded NULs are allowed.
+     *  Malformed sequences are replaced with U+FFFD.
+     */
+    static PString FromUTF8(const char* string,size_t length);
+
+    /** Same as FromUTF8(const char*,size_t).
+     */
+    static PString FromUTF8(const std::string& string);
+
+    /** Returns standard UTF-8 version of the string.
+     * Supplementary characters are encoded as 4-byte sequences, NULs
+     *  as single zero bytes, unpaired surrogates become U+FFFD. The
+     *  value is NOT cached.
+     */
+    std::string ToUTF8() const;
+
+    /** Returns process-wide instance of \c java.lang.String with
+     *  contents of \c string.
+     * The first call creates string and keeps it (with its global
+     *  reference) until the process exits; subsequent calls with the
+     *  same contents return the same instance without allocating
+     *  anything. Contents are copied, so \c string can be any buffer.
+     * Each call takes a global lock, so for literals use JNIPP_STRING()
+     *  which takes the lock only once per literal.
+     */
+    static const PString& Intern(const char* string);
+
+    /** Same as Intern(), but \c literal must have static storage
+     *  duration (e.g. be a string literal), because the result is
+     *  cached by its address. Cached lookups don't take locks.
+     * Use JNIPP_STRING() instead of calling this function directly.
+     */
+    static const PString& InternLiteral(const char* literal);
+
+    /** Returns cache policy of the string.
+     */
+    CachePolicy GetCachePolicy() const;
+
+    /** Sets cache policy of the string.
+     * If the new policy is CacheLast, UTF copy is dropped (pointers
+     *  returned by GetUTF() become invalid).
+     */
+    void SetCachePolicy(CachePolicy policy);
+
+    /** Drops all cached copies of the string.
+     * Pointers returned by Get() and GetUTF() become invalid.
+     */
+    void DropCaches();
+
+    /** Returns policy for new strings.
+     */
+    static CachePolicy GetDefaultCachePolicy();
+
+    /** Sets policy for strings created after the call.
+     */
+    static void SetDefaultCachePolicy(CachePolicy policy);
+
+    /** Returns number of heap bytes currently held by caches of
+     *  all strings in the process.
+     */
+    static size_t GetCachedBytes();
+
 protected:
     virtual ~String();
 private:
     void Construct();
     void RetrieveString();
     void RetrieveUTFString();
-    // These methods will go to #jni some day.
+    void FreeString();
+    void FreeUTFString();
     static jni::LObject NewString(const jchar*);
-    static jni::LObject NewString(const jchar*,jsize);
-    static jni::LObject NewStringUTF(const char*);
 private:
+    enum {
+        InlineStringLength=8,
+        InlineUTFStringLength=16
+    };
     mutable pthreadpp::mutex m_lock;
+    CachePolicy m_cachePolicy;
     jchar* m_string;
     char* m_utfString;
+    size_t m_stringBytes;
+    size_t m_utfStringBytes;
+    jchar m_inlineString[InlineStringLength];
+    char m_inlineUTFString[InlineUTFStringLength];
     static jchar EmptyString[1];
     static char EmptyUTFString[1];
+    static volatile int DefaultCachePolicy;
+    static volatile size_t CachedBytes;
+};
+
+/** Returns interned java::PString for the string literal, see
+ *  String::Intern().
+ * \code
+ * PPattern pattern=Pattern::Compile(JNIPP_STRING("[a-z]+"));
+ * \endcode
+ * Only literals are accepted. The result is cached by address of the
+ *  literal (see String::InternLiteral()), so after the first call no
+ *  locks are taken.
+ */
+#define JNIPP_STRING(literal) \
+    java::String::InternLiteral("" literal)
+
+///////////////////////////////////////////////////////////////////// StringCharsView
+
+/** Scoped access to characters of a Java string.
+ *
+ * Constructor locks string characters with jni::GetStringChars(),
+ *  destructor releases them. Unlike String::Get() nothing is
+ *  allocated or cached by JNIpp (although VM may still decide to
+ *  return a copy, see IsCopy()).
+ *
+ * The string must outlive the view:
+ * \code
+ * java::PString json=...;
+ * java::StringCharsView chars(json);
+ * for (const jchar* c=chars.Begin();c!=chars.End();++c) {
+ *     ...
+ * }
+ * \endcode
+ */
+class StringCharsView {
+public:
+    /** Locks characters of the \c string.
+     */
+    explicit StringCharsView(const jni::AbstractObject& string);
+
+    /** Releases characters.
+     */
+    ~StringCharsView();
+
+    /** Returns characters; the array is not zero-terminated.
+     */
+    const jchar* GetData() const {
+        return m_chars;
+    }
+
+    /** Returns number of characters.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+    /** Returns character at \c index.
+     */
+    jchar operator[](jsize index) const {
+        return m_chars[index];
+    }
+
+    /** Returns pointer to the first character.
+     */
+    const jchar* Begin() const {
+        return m_chars;
+    }
+
+    /** Returns pointer past the last character.
+     */
+    const jchar* End() const {
+        return m_chars+m_length;
+    }
+
+    /** Returns \c true if VM made a copy of the characters.
+     */
+    bool IsCopy() const {
+        return m_isCopy;
+    }
+
+private:
+    StringCharsView(const StringCharsView&);
+    StringCharsView& operator=(const StringCharsView&);
+private:
+    const jni::AbstractObject& m_string;
+    const jchar* m_chars;
+    jsize m_length;
+    bool m_isCopy;
+};
+
+///////////////////////////////////////////////////////////////////// StringCriticalView
+
+/** Scoped critical access to characters of a Java string.
+ *
+ * Same as StringCharsView, but uses jni::GetStringCritical(),
+ *  which makes it much more likely that VM will return pointer
+ *  to the string itself instead of a copy.
+ *
+ * While the view exists current thread is in a "critical region":
+ *  it must not call any #jni functions (that includes creating and
+ *  destroying java::Object wrappers) and must not block waiting for
+ *  other threads that may do so. Keep the scope short.
+ */
+class StringCriticalView {
+public:
+    /** Enters critical region and locks characters of the \c string.
+     */
+    explicit StringCriticalView(const jni::AbstractObject& string);
+
+    /** Releases characters and leaves critical region.
+     */
+    ~StringCriticalView();
+
+    /** Returns characters; the array is not zero-terminated.
+     */
+    const jchar* GetData() const {
+        return m_chars;
+    }
+
+    /** Returns number of characters.
+     */
+    jsize GetLength() const {
+        return m_length;
+    }
+
+    /** Returns character at \c index.
+     */
+    jchar operator[](jsize index) const {
+        return m_chars[index];
+    }
+
+    /** Returns pointer to the first character.
+     */
+    const jchar* Begin() const {
+        return m_chars;
+    }
+
+    /** Returns pointer past the last character.
+     */
+    const jchar* End() const {
+        return m_chars+m_length;
+    }
+
+    /** Returns \c true if VM made a copy of the characters.
+     */
+    bool IsCopy() const {
+        return m_isCopy;
+    }
+
+private:
+    StringCriticalView(const StringCriticalView&);
+    StringCriticalView& operator=(const StringCriticalView&);
+private:
+    const jni::AbstractObject& m_string;
+    const jchar* m_chars;
+    jsize m_length;
+    bool m_isCopy;
 };
 
 ///////////////////////////////////////////////////////////////////// Throwable
@@ -152,6 +152,52 @@ private:
     jobject m_object;
 };
 
+///////////////////////////////////////////////// LocalHandle
+
+/** Non-owning wrapper for a local reference.
+ * Unlike LObject it neither adds nor deletes local references, so
+ *  it costs nothing to create. Use it for references that live in
+ *  a local frame managed by someone else (see PushLocalFrame()),
+ *  e.g. elements returned by java::ObjectArray::Reader.
+ */
+class LocalHandle: public AbstractObject {
+public:
+    /** Constructs empty handle.
+     */
+    LocalHandle():
+        m_object(0)
+    {
+    }
+
+    /** Constructs handle for the \c object.
+     */
+    explicit LocalHandle(jobject object):
+        m_object(object)
+    {
+    }
+
+    /** Returns contained Java object.
+     */
+    virtual jobject GetJObject() const {
+        return m_object;
+    }
+
+    /** Replaces contained Java object.
+     */
+    void Reset(jobject object) {
+        m_object=object;
+    }
+
+    /** Returns \c true if handle is empty (contains NULL Java object).
+     */
+    bool IsEmpty() const {
+        return !m_object;
+    }
+
+private:
+    jobject m_object;
+};
+
 ///////////////////////////////////////////////// NullObject
 
 /** Pass this object instead of NULL.
@@ -291,6 +337,107 @@ void TranslateJavaException();
  */
 void TranslateCppException();
 
+///////////////////////////////////////////////////////////////////// local references
+
+/** Creates new local reference frame in which at least \c capacity
+ *  local references can be created.
+ * Throws Java exception (\c OutOfMemoryError) on failure.
+ */
+void PushLocalFrame(jint capacity);
+
+/** Pops current local reference frame, freeing all local references
+ *  created in it, and returns local reference to the \c result in
+ *  the previous frame.
+ * LObjects created inside the frame must be destroyed before the
+ *  call, otherwise they will delete references that are already gone.
+ */
+LObject PopLocalFrame(const AbstractObject& result);
+
+/** Pops current local reference frame, see PopLocalFrame(const AbstractObject&).
+ */
+void PopLocalFrame();
+
+///////////////////////////////////////////////////////////////////// strings
+
+/** Creates new \c java.lang.String from an array of unicode characters.
+ */
+LObject NewString(const jchar* chars,jsize length);
+
+/** Returns number of unicode characters in the string.
+ */
+jsize GetStringLength(const AbstractObject& string);
+
+/** Retrieves and locks string characters.
+ * Returned array is not zero-terminated.
+ */
+const jchar* GetStringChars(const AbstractObject& string,bool* isCopy=0);
+
+/** Releases characters retrieved by GetStringChars().
+ */
+void ReleaseStringChars(const AbstractObject& string,const jchar* chars);
+
+/** Creates new \c java.lang.String from modified UTF-8 string.
+ */
+LObject NewStringUTF(const char* chars);
+
+/** Returns number of bytes in modified UTF-8 representation
+ *  of the string.
+ */
+jsize GetStringUTFLength(const AbstractObject& string);
+
+/** Retrieves and locks modified UTF-8 representation of the string.
+ * Returned array is zero-terminated.
+ */
+const char* GetStringUTFChars(const AbstractObject& string,bool* isCopy=0);
+
+/** Releases characters retrieved by GetStringUTFChars().
+ */
+void ReleaseStringUTFChars(const AbstractObject& string,const char* chars);
+
+/** Copies \c length unicode characters starting at \c start
+ *  to the \c buffer.
+ */
+void GetStringRegion(const AbstractObject& string,jsize start,jsize length,jchar* buffer);
+
+/** Converts \c length unicode characters starting at \c start
+ *  to modified UTF-8 and stores them in the \c buffer.
+ * Buffer must be large enough to hold the result (which is at
+ *  most 3*length bytes).
+ */
+void GetStringUTFRegion(const AbstractObject& string,jsize start,jsize length,char* buffer);
+
+/** Retrieves string characters, preferably without copying.
+ *
+ * Code between GetStringCritical() and ReleaseStringCritical()
+ *  runs in a "critical region" and must not call any #jni
+ *  functions or block waiting for other threads. See also
+ *  GetPrimitiveArrayCritical().
+ */
+const jchar* GetStringCritical(const AbstractObject& string,bool* isCopy=0);
+
+/** Releases characters retrieved by GetStringCritical().
+ */
+void ReleaseStringCritical(const AbstractObject& string,const jchar* chars);
+
+///////////////////////////////////////////////////////////////////// direct buffers
+
+/** Creates \c java.nio.ByteBuffer that refers to \c capacity bytes of
+ *  native memory starting at \c address.
+ * Memory must stay valid while the buffer is used by Java.
+ *  Calls FatalError() if VM doesn't support direct buffers.
+ */
+LObject NewDirectByteBuffer(void* address,jlong capacity);
+
+/** Returns memory address of the direct \c buffer or NULL if
+ *  buffer is not direct.
+ */
+void* GetDirectBufferAddress(const AbstractObject& buffer);
+
+/** Returns capacity (in elements) of the direct \c buffer or -1 if
+ *  buffer is not direct.
+ */
+jlong GetDirectBufferCapacity(const AbstractObject& buffer);
+
 ///////////////////////////////////////////////////////////////////// arrays
 
 /** Release mode for ReleaseXXXArrayElements functions.
@@ -330,6 +477,26 @@ const bool JBooleanIsBool=
  */
 jsize GetArrayLength(const AbstractObject& array);
 
+/** Retrieves elements of a primitive array, preferably without
+ *  copying.
+ *
+ * Code between GetPrimitiveArrayCritical() and ReleasePrimitiveArrayCritical()
+ *  runs in a "critical region" and must not call any #jni functions
+ *  (other than nested Get/ReleaseXXXCritical) or block waiting for
+ *  other threads. In debug builds (NDEBUG is not defined) GetEnv()
+ *  calls FatalError() when called inside a critical region.
+ *
+ * Returns NULL if VM failed to allocate a copy; in that case
+ *  \c OutOfMemoryError is pending, call TranslateJavaException()
+ *  after leaving all other critical regions.
+ */
+void* GetPrimitiveArrayCritical(const AbstractObject& array,bool* isCopy=0);
+
+/** Releases (and optionally commits) elements retrieved by
+ *  GetPrimitiveArrayCritical().
+ */
+void ReleasePrimitiveArrayCritical(const AbstractObject& array,void* elements,ArrayReleaseMode mode);
+
 /////////////////////////////////////// object[]
 
 /** Creates new object array and fills it with nulls.
@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file
+ * Contains wrappers for \c java.nio buffers.
+ */
+
+#ifndef _JNIPP_JAVANIO_INCLUDED_
+#define _JNIPP_JAVANIO_INCLUDED_
+
+#include <stddef.h>
+#include "JavaLang.h"
+
+BEGIN_NAMESPACE(java)
+
+/** Contains wrappers for \c java.nio classes.
+ */
+BEGIN_NAMESPACE(nio)
+
+///////////////////////////////////////////////////////////////////// Buffer
+
+class Buffer;
+/** Pointer to Buffer.
+ */
+typedef ObjectPointer<Buffer> PBuffer;
+
+
+/** Wrapper for \c java.nio.Buffer.
+ */
+class Buffer: public Object {
+    JB_WRAPPER_CLASS(Buffer);
+public:
+    /** Wraps \c buffer.
+     */
+    explicit Buffer(const jni::LObject& buffer);
+
+    /** Returns buffer's capacity (in elements).
+     */
+    jint GetCapacity() const;
+
+    /** Returns buffer's position.
+     */
+    jint GetPosition() const;
+
+    /** Sets buffer's position.
+     */
+    void SetPosition(jint position);
+
+    /** Returns buffer's limit.
+     */
+    jint GetLimit() const;
+
+    /** Sets buffer's limit.
+     */
+    void SetLimit(jint limit);
+
+    /** Returns \c true if buffer is direct.
+     */
+    bool IsDirect() const;
+
+    /** Returns address of direct buffer's memory or NULL if buffer
+     *  is not direct.
+     * Unlike other methods this one doesn't call Java.
+     */
+    void* GetDirectAddress() const;
+
+    /** Returns capacity (in elements) of direct buffer or -1 if
+     *  buffer is not direct.
+     * Unlike other methods this one doesn't call Java.
+     */
+    jlong GetDirectCapacity() const;
+};
+
+///////////////////////////////////////////////////////////////////// TypedBuffer
+
+/** Wrapper for typed buffers (like \c java.nio.IntBuffer).
+ * You don't need to use this class, use typedefs like
+ *  java::nio::PIntBuffer instead.
+ *
+ * Data accessors work only for direct buffers and return NULL
+ *  for others.
+ */
+template <class JType>
+class TypedBuffer: public Buffer {
+    JB_WRAPPER_CLASS(TypedBuffer);
+public:
+    /** Wraps \c buffer.
+     */
+    explicit TypedBuffer(const jni::LObject& buffer):
+        Buffer(buffer)
+    {
+    }
+
+    /** Returns buffer's memory.
+     */
+    JType* GetData() const {
+        return static_cast<JType*>(GetDirectAddress());
+    }
+
+    /** Returns number of elements.
+     */
+    jlong GetLength() const {
+        return GetDirectCapacity();
+    }
+
+    /** Returns pointer to the first element.
+     */
+    JType* Begin() const {
+        return GetData();
+    }
+
+    /** Returns pointer past the last element.
+     */
+    JType* End() const {
+        JType* data=GetData();
+        return data ? data+GetLength() : 0;
+    }
+
+private:
+    static java::Class* m_class;
+};
+
+template <class JType>
+java::Class* TypedBuffer<JType>::m_class=0;
+
+///////////////////////////////////////////////// typedefs
+
+/** Buffer of ints (\c java.nio.IntBuffer).
+ */
+typedef TypedBuffer<jint> IntBuffer;
+/** Pointer to IntBuffer.
+ */
+typedef ObjectPointer<IntBuffer> PIntBuffer;
+
+
+/** Buffer of floats (\c java.nio.FloatBuffer).
+ */
+typedef TypedBuffer<jfloat> FloatBuffer;
+/** Pointer to FloatBuffer.
+ */
+typedef ObjectPointer<FloatBuffer> PFloatBuffer;
+
+
+/** Buffer of doubles (\c java.nio.DoubleBuffer).
+ */
+typedef TypedBuffer<jdouble> DoubleBuffer;
+/** Pointer to DoubleBuffer.
+ */
+typedef ObjectPointer<DoubleBuffer> PDoubleBuffer;
+
+///////////////////////////////////////////////////////////////////// ByteBuffer
+
+class ByteBuffer;
+/** Pointer to ByteBuffer.
+ */
+typedef ObjectPointer<ByteBuffer> PByteBuffer;
+
+
+/** Wrapper for \c java.nio.ByteBuffer.
+ *
+ * To hand native memory to Java create ByteBuffer from it:
+ * \code
+ * java::nio::PByteBuffer frame=new java::nio::ByteBuffer(pixels,size);
+ * renderer->Draw(frame); // Java sees pixels without copying
+ * \endcode
+ * To access memory of a Java direct buffer use GetData():
+ * \code
+ * java::nio::PFloatBuffer samples=buffer->AsFloatBuffer();
+ * Process(samples->GetData(),samples->GetLength());
+ * \endcode
+ */
+class ByteBuffer: public Buffer {
+    JB_WRAPPER_CLASS(ByteBuffer);
+public:
+    /** Creates direct \c java.nio.ByteBuffer that refers to \c capacity
+     *  bytes of native memory at \c address and wraps it.
+     * The memory is not copied and must stay valid while Java uses
+     *  the buffer.
+     */
+    ByteBuffer(void* address,jlong capacity);
+
+    /** Wraps \c buffer.
+     */
+    explicit ByteBuffer(const jni::LObject& buffer);
+
+    /** Allocates direct buffer of \c capacity bytes in Java
+     *  (\c ByteBuffer.allocateDirect()).
+     */
+    static PByteBuffer AllocateDirect(jint capacity);
+
+    /** Returns buffer's memory, see Buffer::GetDirectAddress().
+     */
+    jbyte* GetData() const {
+        return static_cast<jbyte*>(GetDirectAddress());
+    }
+
+    /** Returns number of bytes, see Buffer::GetDirectCapacity().
+     */
+    jlong GetLength() const {
+        return GetDirectCapacity();
+    }
+
+    /** Sets byte order to the native one, so that values written by
+     *  Java can be read directly by C++ and vice versa.
+     */
+    void SetNativeOrder();
+
+    /** Returns \c int view of the buffer in native byte order.
+     * Byte order of the buffer itself is not changed.
+     */
+    PIntBuffer AsIntBuffer() const;
+
+    /** Returns \c float view of the buffer in native byte order.
+     */
+    PFloatBuffer AsFloatBuffer() const;
+
+    /** Returns \c double view of the buffer in native byte order.
+     */
+    PDoubleBuffer AsDoubleBuffer() const;
+
+    /** Returns read-only view of the buffer (\c asReadOnlyBuffer()).
+     * The view shares memory with the buffer and is direct if
+     *  buffer is direct.
+     */
+    PByteBuffer AsReadOnlyBuffer() const;
+
+private:
+    jni::LObject DuplicateInNativeOrder() const;
+};
+
+///////////////////////////////////////////////////////////////////// MappedFile
+
+/** Memory-mapped file that can be shared with Java as a direct
+ *  ByteBuffer.
+ *
+ * File (or its part) is mapped in constructor and is accessible
+ *  natively through GetData(). GetBuffer() exposes the same memory to
+ *  Java, so both sides can read large files without copying them into
+ *  arrays:
+ * \code
+ * java::nio::MappedFile file(path,java::nio::MappedFile::ReadOnly,
+ *     java::nio::MappedFile::AdviseSequential);
+ * Decode(file.GetData(),file.GetLength());
+ * listener->OnLoaded(file.GetBuffer());
+ * \endcode
+ *
+ * File is mapped by Java (\c FileChannel.map()), so the mapping is
+ *  owned by the returned \c MappedByteBuffer: MappedFile keeps a
+ *  reference to it, and Java unmaps the file only after MappedFile is
+ *  destroyed and the buffer and all views created from it (slices,
+ *  duplicates) are collected. It's therefore safe to destroy MappedFile
+ *  while Java still uses the buffer, but GetData() must not be used
+ *  after that.
+ *
+ * Java buffers can't be larger than 2GB, map larger files in parts
+ *  using constructor with offset and length. Private mappings require
+ *  write access to the file (a \c FileChannel restriction).
+ *
+ * Errors (file can't be opened or mapped) are reported by throwing
+ *  \c java.io.IOException.
+ */
+class MappedFile {
+public:
+    /** Mapping modes.
+     */
+    enum Mode {
+        /** File is mapped for reading only, GetBuffer() returns
+         *  read-only buffer.
+         */
+        ReadOnly,
+        /** File is mapped for reading and writing, changes are
+         *  written back to the file.
+         */
+        ReadWrite,
+        /** File is mapped copy-on-write, changes are private and
+         *  are not written back to the file.
+         */
+        Private
+    };
+
+    /** Access pattern hints (see \c madvise()).
+     */
+    enum Advice {
+        AdviseNormal,
+        AdviseSequential,
+        AdviseRandom,
+        AdviseWillNeed,
+        AdviseDontNeed
+    };
+
+public:
+    /** Maps the whole file at \c path.
+     */
+    explicit MappedFile(const char* path,Mode mode=ReadOnly,Advice advice=AdviseNormal);
+
+    /** Maps \c length bytes of the file at \c path starting
+     *  from \c offset (which doesn't need to be page-aligned).
+     */
+    MappedFile(const char* path,jlong offset,size_t length,
+        Mode mode=ReadOnly,Advice advice=AdviseNormal);
+
+    /** Releases the buffer; the file is unmapped once Java collects
+     *  it and all its views.
+     */
+    ~MappedFile();
+
+    /** Returns mapped memory (NULL if length is 0).
+     */
+    jbyte* GetData() const {
+        return m_data;
+    }
+
+    /** Returns length of mapped memory.
+     */
+    size_t GetLength() const {
+        return m_length;
+    }
+
+    /** Returns mapping mode.
+     */
+    Mode GetMode() const {
+        return m_mode;
+    }
+
+    /** Returns direct ByteBuffer for the mapped memory.
+     * The same Java buffer (read-only for ReadOnly mappings) is
+     *  always returned.
+     */
+    PByteBuffer GetBuffer() const;
+
+    /** Gives kernel a hint about access pattern.
+     */
+    void Advise(Advice advice);
+
+    /** Writes changes back to the file (\c msync()).
+     * Does nothing for ReadOnly and Private mappings.
+     */
+    void Sync();
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    void Map(const char* path,jlong offset,size_t length,bool wholeFile,Advice advice);
+private:
+    Mode m_mode;
+    jbyte* m_data;
+    size_t m_length;
+    PByteBuffer m_buffer;
+};
+
+///////////////////////////////////////////////////////////////////// RingBuffer
+
+/** Single-producer/single-consumer ring buffer that lives in a direct
+ *  ByteBuffer and is shared with Java.
+ *
+ * Java side is implemented by \c com.itoa.jnipp.RingBuffer class
+ *  (see \c java/com/itoa/jnipp/RingBuffer.java). One side writes,
+ *  another reads; read and write positions are kept in the buffer
+ *  itself (on separate cache lines), so data is exchanged without
+ *  copying through JNI. Native side makes no JNI calls at all; Java
+ *  side reads and publishes positions through small native methods,
+ *  because Java (before 9) has no ordered accesses to buffers:
+ * \code
+ * // Native audio thread
+ * while (playing) {
+ *   jshort pcm[1024];
+ *   size_t length=DecodeNext(pcm,sizeof(pcm));
+ *   for (const char* data=(const char*)pcm;length;) {
+ *     ring.WaitWritable(-1);
+ *     size_t written=ring.Write(data,length);
+ *     data+=written;
+ *     length-=written;
+ *   }
+ * }
+ * \endcode
+ *
+ * Waiting functions block on a futex (on Linux), and the other side
+ *  wakes it only when a waiter is flagged. Java side native methods
+ *  must be registered with RegisterNatives() before Java uses the
+ *  ring.
+ *
+ * Buffer layout: HeaderSize bytes of header followed by data, whose
+ *  length (capacity) must be a power of two.
+ */
+class RingBuffer {
+public:
+    /** Size of the header preceding data in the buffer.
+     */
+    static const jint HeaderSize=192;
+
+public:
+    /** Allocates direct buffer for a ring with \c capacity bytes
+     *  of data. \c capacity must be a power of two.
+     */
+    explicit RingBuffer(jint capacity);
+
+    /** Attaches to a ring created by Java (or by another RingBuffer).
+     * Calls jni::FatalError() if \c buffer is not a valid ring.
+     */
+    explicit RingBuffer(PByteBuffer buffer);
+
+    /** Returns underlying direct buffer; pass it to the Java side.
+     */
+    PByteBuffer GetBuffer() const {
+        return m_buffer;
+    }
+
+    /** Returns capacity of the ring (in bytes).
+     */
+    size_t GetCapacity() const {
+        return m_capacity;
+    }
+
+    /** Returns number of bytes available for reading.
+     * Must be called from the consumer side.
+     */
+    size_t GetReadableLength() const;
+
+    /** Returns number of bytes available for writing.
+     * Must be called from the producer side.
+     */
+    size_t GetWritableLength() const;
+
+    /** Writes up to \c length bytes and returns number of bytes
+     *  written. Doesn't block.
+     */
+    size_t Write(const void* data,size_t length);
+
+    /** Reads up to \c length bytes and returns number of bytes
+     *  read. Doesn't block.
+     */
+    size_t Read(void* data,size_t length);
+
+    /** Waits until there is something to read. Returns \c false on
+     *  timeout. Negative \c timeoutMillis means wait forever.
+     */
+    bool WaitReadable(jlong timeoutMillis);
+
+    /** Waits until there is space to write. Returns \c false on
+     *  timeout. Negative \c timeoutMillis means wait forever.
+     */
+    bool WaitWritable(jlong timeoutMillis);
+
+    /** Registers native methods of \c com.itoa.jnipp.RingBuffer.
+     * Call it once (e.g. in JNI_OnLoad()) if the Java class is used.
+     */
+    static void RegisterNatives();
+
+private:
+    RingBuffer(const RingBuffer&);
+    RingBuffer& operator=(const RingBuffer&);
+
+    void Attach(PByteBuffer buffer);
+    volatile jint* GetHeaderInt(jint offset) const;
+    bool Wait(bool forReading,jlong timeoutMillis);
+private:
+    PByteBuffer m_buffer;
+    jbyte* m_header;
+    jbyte* m_data;
+    size_t m_capacity;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(nio)
+
+END_NAMESPACE(java)
+
+#endif // _JNIPP_JAVANIO_INCLUDED_
@@ -21,6 +21,7 @@
 #ifndef _JNIPP_JAVAOBJECT_INCLUDED_
 #define _JNIPP_JAVAOBJECT_INCLUDED_
 
+#include <stdint.h>
 #include <typeinfo>
 #include <dropins/pthreadpp.h>
 #include "JavaNI.h"
@@ -119,6 +120,8 @@ public:
     /** Returns instance field id.
      * Instance field must be declared as:
       * - <tt> private int nativeInstance; </tt>
+      * - <tt> private long nativeInstance; </tt> if
+      *    JNIPP_NATIVE_INSTANCE_LONG is defined.
      * Added by JB_LIVE_CLASS() macro.
      */
     static jfieldID GetInstanceFieldID();
@@ -167,6 +170,9 @@ public:
     virtual jobject GetJObject() const;
 
     /** Retrieves object instance pointer from the Java object.
+     * Returns NULL if there is no instance, or (when
+     *  JNIPP_NATIVE_INSTANCE_HANDLES is defined) if the stored
+     *  handle is stale.
      */
     static Object* GetLiveInstance(jobject object,jfieldID instanceFieldID);
 
@@ -222,8 +228,8 @@ protected:
 
     /** Constructs live object.
      * Method performs the following:
-     * - Sets instance pointer (\c this) to the \c int field
-     *    identified by \c instanceFieldID.
+     * - Sets instance pointer (\c this) or its handle to the
+     *    field identified by \c instanceFieldID.
      * - Sets reference count to 1.
      * - Stores Java object and adds weak reference to it.
      *
@@ -241,10 +247,35 @@ private:
     mutable jobject m_object;
     jobject m_weakReference;
     jfieldID m_instanceFieldID;
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+    jlong m_instanceHandle;
+#endif
     mutable size_t m_referenceCount;
     mutable pthreadpp::mutex m_lock;
 };
 
+///////////////////////////////////////////////////////////////////// InstanceHandle
+
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+
+/* Handle table used by live objects when JNIPP_NATIVE_INSTANCE_HANDLES
+ *  is defined. Internal, declared here for tests.
+ */
+
+/* Returns new non-zero handle for the object. */
+jlong CreateInstanceHandle(Object* object);
+
+/* Frees handle's slot; stale handles are ignored. */
+void DestroyInstanceHandle(jlong handle);
+
+/* Returns object for the handle, or NULL if handle is stale. */
+Object* ResolveInstanceHandle(jlong handle);
+
+/* Returns generation that follows 'generation', skipping 0. */
+uint32_t NextInstanceHandleGeneration(uint32_t generation);
+
+#endif // JNIPP_NATIVE_INSTANCE_HANDLES
+
 /////////////////////////////////////////////////////////////////////
 
 END_NAMESPACE(java)
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file
+ * Contains helpers for decoding and encoding packed binary records
+ *  stored in Java byte arrays and direct buffers.
+ */
+
+#ifndef _JNIPP_JAVAPACKED_INCLUDED_
+#define _JNIPP_JAVAPACKED_INCLUDED_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "JavaArray.h"
+#include "JavaNio.h"
+
+BEGIN_NAMESPACE(java)
+
+///////////////////////////////////////////////////////////////////// byte order
+
+/** Byte order of packed values.
+ * Java streams (\c DataOutputStream) and non-direct buffers use
+ *  BigEndian.
+ */
+enum ByteOrder {
+    BigEndian,
+    LittleEndian
+};
+
+/** Byte order of the platform.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+const ByteOrder NativeByteOrder=BigEndian;
+#else
+const ByteOrder NativeByteOrder=LittleEndian;
+#endif
+
+/** Reverses bytes of \c count elements of \c elementSize bytes each
+ *  (1, 2, 4 or 8). Uses SSE2/SSSE3/NEON when compiler targets them.
+ * Pointers don't need to be aligned. \c in and \c out may point to
+ *  the same memory, but must not overlap otherwise.
+ */
+void SwapBytes(const void* in,size_t count,size_t elementSize,void* out);
+
+/** Decodes \c count values of type \c T stored in \c order from
+ *  \c in to \c out.
+ */
+template <class T>
+inline void DecodeElements(const void* in,size_t count,T* out,ByteOrder order=BigEndian) {
+    if (order==NativeByteOrder) {
+        memcpy(out,in,count*sizeof(T));
+    } else {
+        SwapBytes(in,count,sizeof(T),out);
+    }
+}
+
+/** Encodes \c count values of type \c T from \c in to \c out
+ *  in \c order.
+ */
+template <class T>
+inline void EncodeElements(const T* in,size_t count,void* out,ByteOrder order=BigEndian) {
+    if (order==NativeByteOrder) {
+        memcpy(out,in,count*sizeof(T));
+    } else {
+        SwapBytes(in,count,sizeof(T),out);
+    }
+}
+
+///////////////////////////////////////////////// single values
+
+/* Unsigned type of the given size and its byte swap. */
+template <size_t Size>
+struct PackedBits;
+
+template <>
+struct PackedBits<1> {
+    typedef uint8_t Type;
+    static Type Swap(Type value) {
+        return value;
+    }
+};
+
+template <>
+struct PackedBits<2> {
+    typedef uint16_t Type;
+    static Type Swap(Type value) {
+        return Type((value>>8) | (value<<8));
+    }
+};
+
+template <>
+struct PackedBits<4> {
+    typedef uint32_t Type;
+    static Type Swap(Type value) {
+        return __builtin_bswap32(value);
+    }
+};
+
+template <>
+struct PackedBits<8> {
+    typedef uint64_t Type;
+    static Type Swap(Type value) {
+        return __builtin_bswap64(value);
+    }
+};
+
+/** Reads value of type \c T stored in \c order at (possibly
+ *  unaligned) \c data.
+ */
+template <class T>
+inline T LoadPacked(const void* data,ByteOrder order=BigEndian) {
+    typedef PackedBits<sizeof(T)> Bits;
+    typename Bits::Type bits;
+    memcpy(&bits,data,sizeof(T));
+    if (order!=NativeByteOrder) {
+        bits=Bits::Swap(bits);
+    }
+    T value;
+    memcpy(&value,&bits,sizeof(T));
+    return value;
+}
+
+/** Writes \c value to (possibly unaligned) \c data in \c order.
+ */
+template <class T>
+inline void StorePacked(void* data,T value,ByteOrder order=BigEndian) {
+    typedef PackedBits<sizeof(T)> Bits;
+    typename Bits::Type bits;
+    memcpy(&bits,&value,sizeof(T));
+    if (order!=NativeByteOrder) {
+        bits=Bits::Swap(bits);
+    }
+    memcpy(data,&bits,sizeof(T));
+}
+
+///////////////////////////////////////////////////////////////////// PackedField
+
+/** Describes field of a packed record: its type, offset and byte
+ *  order.
+ *
+ * Record layouts are described by structs with field typedefs and
+ *  \c Size constant:
+ * \code
+ * struct Sample {
+ *     typedef java::PackedField<jint,0> Id;
+ *     typedef java::PackedField<jlong,4> Timestamp;
+ *     typedef java::PackedField<jfloat,12> Value;
+ *     enum { Size=16 };
+ * };
+ * \endcode
+ * Such layouts are used with PackedRecords.
+ */
+template <class T,size_t Offset,ByteOrder FieldOrder=BigEndian>
+struct PackedField {
+    typedef T ValueType;
+    static const ByteOrder Order=FieldOrder;
+    enum {
+        Begin=Offset,
+        End=Offset+sizeof(T)
+    };
+
+    /** Reads the field from \c record.
+     */
+    static T Get(const jbyte* record) {
+        return LoadPacked<T>(record+Offset,FieldOrder);
+    }
+
+    /** Writes the field to \c record.
+     */
+    static void Set(jbyte* record,T value) {
+        StorePacked(record+Offset,value,FieldOrder);
+    }
+};
+
+///////////////////////////////////////////////////////////////////// PackedRecords
+
+/** Typed access to a sequence of packed records in native memory.
+ *
+ * Records are described by \c Layout (see PackedField). Trailing
+ *  bytes that don't form a whole record are ignored.
+ * \code
+ * java::PackedRecords<Sample> records(buffer->GetData(),buffer->GetLength());
+ * for (size_t i=0;i!=records.GetCount();++i) {
+ *     Process(records.Get<Sample::Id>(i),records.Get<Sample::Value>(i));
+ * }
+ * \endcode
+ * GetColumn() and SetColumn() process one field of many records
+ *  at once; byte swapping is then done in a single vectorized pass.
+ *
+ * To access records stored in a byte array use PackedArrayRecords.
+ */
+template <class Layout>
+class PackedRecords {
+public:
+
+    /** Wraps \c length bytes at \c data.
+     */
+    PackedRecords(jbyte* data,size_t length):
+        m_data(data),
+        m_count(length/Layout::Size)
+    {
+    }
+
+    /** Wraps memory of a direct \c buffer.
+     */
+    explicit PackedRecords(const nio::ByteBuffer& buffer):
+        m_data(buffer.GetData()),
+        m_count(size_t(buffer.GetLength())/Layout::Size)
+    {
+    }
+
+    /** Returns number of records.
+     */
+    size_t GetCount() const {
+        return m_count;
+    }
+
+    /** Returns pointer to the record at \c index.
+     */
+    jbyte* GetRecord(size_t index) const {
+        if (index>=m_count) {
+            jni::FatalError("PackedRecords: index %d is out of bounds [0,%d).",
+                int(index),int(m_count));
+        }
+        return m_data+index*Layout::Size;
+    }
+
+    /** Reads \c Field of the record at \c index.
+     */
+    template <class Field>
+    typename Field::ValueType Get(size_t index) const {
+        CheckField<Field>();
+        return Field::Get(GetRecord(index));
+    }
+
+    /** Writes \c Field of the record at \c index.
+     */
+    template <class Field>
+    void Set(size_t index,typename Field::ValueType value) const {
+        CheckField<Field>();
+        Field::Set(GetRecord(index),value);
+    }
+
+    /** Reads \c Field of \c count records starting at \c first.
+     */
+    template <class Field>
+    void GetColumn(size_t first,size_t count,typename Field::ValueType* out) const {
+        CheckField<Field>();
+        CheckRange(first,count);
+        const jbyte* record=m_data+first*Layout::Size+Field::Begin;
+        for (size_t i=0;i!=count;++i,record+=Layout::Size) {
+            memcpy(out+i,record,sizeof(*out));
+        }
+        if (Field::Order!=NativeByteOrder) {
+            SwapBytes(out,count,sizeof(*out),out);
+        }
+    }
+
+    /** Writes \c Field of \c count records starting at \c first.
+     */
+    template <class Field>
+    void SetColumn(size_t first,size_t count,const typename Field::ValueType* in) const {
+        typedef typename Field::ValueType ValueType;
+        CheckField<Field>();
+        CheckRange(first,count);
+        ValueType buffer[ColumnChunkLength];
+        jbyte* record=m_data+first*Layout::Size+Field::Begin;
+        while (count) {
+            size_t chunk=(count<size_t(ColumnChunkLength)) ? count : size_t(ColumnChunkLength);
+            EncodeElements(in,chunk,buffer,Field::Order);
+            for (size_t i=0;i!=chunk;++i,record+=Layout::Size) {
+                memcpy(record,buffer+i,sizeof(ValueType));
+            }
+            in+=chunk;
+            count-=chunk;
+        }
+    }
+
+protected:
+    PackedRecords():
+        m_data(0),
+        m_count(0)
+    {
+    }
+
+    void Reset(jbyte* data,size_t length) {
+        m_data=data;
+        m_count=length/Layout::Size;
+    }
+
+private:
+    /* Size of stack buffer used by SetColumn(). */
+    enum { ColumnChunkLength=256 };
+
+    template <class Field>
+    static void CheckField() {
+        (void)sizeof(char[(size_t(Field::End)<=size_t(Layout::Size)) ? 1 : -1]);
+    }
+
+    void CheckRange(size_t first,size_t count) const {
+        if (first>m_count || count>m_count-first) {
+            jni::FatalError("PackedRecords: range [%d,%d) is out of bounds [0,%d).",
+                int(first),int(first+count),int(m_count));
+        }
+    }
+
+private:
+    jbyte* m_data;
+    size_t m_count;
+};
+
+///////////////////////////////////////////////// PackedArrayRecords
+
+/** PackedRecords over elements of a byte array.
+ *
+ * The array is pinned with ByteArray::Critical for the lifetime
+ *  of the object, so the same rules apply: no #jni calls until the
+ *  object is destroyed. Decode a batch of records, release the array
+ *  and only then pass results to Java. Changes are written back on
+ *  destruction; call Abort() if records were only read.
+ *
+ * If processing needs #jni calls, pin the array with
+ *  ByteArray::Elements and use PackedRecords directly.
+ */
+template <class Layout>
+class PackedArrayRecords: public PackedRecords<Layout> {
+public:
+
+    /** Pins elements of the \c array.
+     */
+    explicit PackedArrayRecords(ByteArray& array):
+        m_critical(array)
+    {
+        this->Reset(m_critical.GetData(),size_t(m_critical.GetLength()));
+    }
+
+    /** Releases the array without writing changes back.
+     * No records are accessible after that.
+     */
+    void Abort() {
+        m_critical.Abort();
+        this->Reset(0,0);
+    }
+
+    /** Writes changes back and releases the array.
+     * No records are accessible after that.
+     */
+    void Release() {
+        m_critical.Release();
+        this->Reset(0,0);
+    }
+
+private:
+    ByteArray::Critical m_critical;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(java)
+
+#endif // _JNIPP_JAVAPACKED_INCLUDED_
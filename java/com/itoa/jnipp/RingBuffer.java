@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.itoa.jnipp;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/* Java side of java::nio::RingBuffer, see JavaNio.h.
+ *
+ * Single-producer/single-consumer ring of bytes in a direct buffer.
+ *  Layout of the header must match JavaNio.cpp.
+ *
+ * Java has no ordered accesses to buffer memory (before Java 9), so
+ *  positions written by the other side are loaded, and own positions
+ *  are published, by native methods. They surround the access with
+ *  full barriers, like native code does, which also separates waiting
+ *  flags from positions. Own position and data are accessed directly.
+ *
+ * Native methods are registered by
+ *  java::nio::RingBuffer::RegisterNatives().
+ */
+public final class RingBuffer {
+
+    /*** Public interface ***/
+
+    public static final int HEADER_SIZE=192;
+
+    /* Creates ring with 'capacity' bytes of data, 'capacity' must
+     *  be a power of two.
+     */
+    public RingBuffer(int capacity) {
+        if (capacity<=0 || (capacity & (capacity-1))!=0) {
+            throw new IllegalArgumentException("Capacity must be a power of two.");
+        }
+        ByteBuffer buffer=ByteBuffer.allocateDirect(HEADER_SIZE+capacity);
+        buffer.order(ByteOrder.nativeOrder());
+        buffer.putInt(CAPACITY_OFFSET,capacity);
+        attach(buffer);
+    }
+
+    /* Attaches to a ring created by native code (or by another
+     *  RingBuffer).
+     */
+    public RingBuffer(ByteBuffer buffer) {
+        if (!buffer.isDirect() || buffer.capacity()<HEADER_SIZE) {
+            throw new IllegalArgumentException("Buffer doesn't contain valid ring.");
+        }
+        buffer=buffer.duplicate();
+        buffer.order(ByteOrder.nativeOrder());
+        int capacity=buffer.getInt(CAPACITY_OFFSET);
+        if (capacity<=0 || (capacity & (capacity-1))!=0 ||
+            capacity>buffer.capacity()-HEADER_SIZE)
+        {
+            throw new IllegalArgumentException("Buffer doesn't contain valid ring.");
+        }
+        attach(buffer);
+    }
+
+    public ByteBuffer getBuffer() {
+        return header;
+    }
+
+    public int getCapacity() {
+        return capacity;
+    }
+
+    /* Must be called from the consumer side. */
+    public int getReadableLength() {
+        int writePosition=nativeLoad(header,WRITE_POSITION_OFFSET);
+        return writePosition-header.getInt(READ_POSITION_OFFSET);
+    }
+
+    /* Must be called from the producer side. */
+    public int getWritableLength() {
+        int readPosition=nativeLoad(header,READ_POSITION_OFFSET);
+        return capacity-(header.getInt(WRITE_POSITION_OFFSET)-readPosition);
+    }
+
+    /* Writes up to 'length' bytes, returns number of bytes written.
+     */
+    public int write(byte[] bytes,int offset,int length) {
+        length=Math.min(length,getWritableLength());
+        if (length==0) {
+            return 0;
+        }
+        int writePosition=header.getInt(WRITE_POSITION_OFFSET);
+        int dataOffset=writePosition & (capacity-1);
+        int head=Math.min(length,capacity-dataOffset);
+        data.position(dataOffset);
+        data.put(bytes,offset,head);
+        data.position(0);
+        data.put(bytes,offset+head,length-head);
+
+        nativeStore(header,WRITE_POSITION_OFFSET,writePosition+length);
+        if (header.getInt(READER_WAITING_OFFSET)!=0) {
+            nativeWake(header,WRITE_POSITION_OFFSET);
+        }
+        return length;
+    }
+
+    /* Reads up to 'length' bytes, returns number of bytes read.
+     */
+    public int read(byte[] bytes,int offset,int length) {
+        length=Math.min(length,getReadableLength());
+        if (length==0) {
+            return 0;
+        }
+        int readPosition=header.getInt(READ_POSITION_OFFSET);
+        int dataOffset=readPosition & (capacity-1);
+        int head=Math.min(length,capacity-dataOffset);
+        data.position(dataOffset);
+        data.get(bytes,offset,head);
+        data.position(0);
+        data.get(bytes,offset+head,length-head);
+
+        nativeStore(header,READ_POSITION_OFFSET,readPosition+length);
+        if (header.getInt(WRITER_WAITING_OFFSET)!=0) {
+            nativeWake(header,READ_POSITION_OFFSET);
+        }
+        return length;
+    }
+
+    /* Wait until there is something to read / space to write.
+     * Return false on timeout, negative timeout means forever.
+     */
+    public boolean waitReadable(long timeoutMillis) {
+        return await(true,timeoutMillis);
+    }
+
+    public boolean waitWritable(long timeoutMillis) {
+        return await(false,timeoutMillis);
+    }
+
+
+    /*** Implementation details ***/
+
+    private static final int WRITE_POSITION_OFFSET=0;
+    private static final int READER_WAITING_OFFSET=4;
+    private static final int READ_POSITION_OFFSET=64;
+    private static final int WRITER_WAITING_OFFSET=68;
+    private static final int CAPACITY_OFFSET=128;
+
+    private void attach(ByteBuffer buffer) {
+        header=buffer;
+        capacity=buffer.getInt(CAPACITY_OFFSET);
+        buffer=buffer.duplicate();
+        buffer.position(HEADER_SIZE);
+        buffer.limit(HEADER_SIZE+capacity);
+        data=buffer.slice();
+    }
+
+    private boolean await(boolean forReading,long timeoutMillis) {
+        int positionOffset=forReading?WRITE_POSITION_OFFSET:READ_POSITION_OFFSET;
+        int waitingOffset=forReading?READER_WAITING_OFFSET:WRITER_WAITING_OFFSET;
+        long deadline=System.nanoTime()/1000000+timeoutMillis;
+        while (true) {
+            if ((forReading?getReadableLength():getWritableLength())!=0) {
+                return true;
+            }
+            long remaining=timeoutMillis;
+            if (timeoutMillis>0) {
+                remaining=Math.max(0,deadline-System.nanoTime()/1000000);
+            }
+            if (remaining==0) {
+                return false;
+            }
+            header.putInt(waitingOffset,1);
+            int observed=nativeLoad(header,positionOffset);
+            if ((forReading?getReadableLength():getWritableLength())==0) {
+                nativeWait(header,positionOffset,observed,remaining);
+            }
+            header.putInt(waitingOffset,0);
+        }
+    }
+
+    private static native int nativeLoad(ByteBuffer header,int offset);
+    private static native void nativeStore(ByteBuffer header,int offset,int value);
+    private static native void nativeWait(ByteBuffer header,int offset,int expected,long timeoutMillis);
+    private static native void nativeWake(ByteBuffer header,int offset);
+
+    private ByteBuffer header;
+    private ByteBuffer data;
+    private int capacity;
+}
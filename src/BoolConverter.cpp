@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BoolConverter.h"
+
+/* Conversion is only needed on ABIs where bool differs from jboolean
+ *  (none of the supported ones), so it's kept simple.
+ */
+
+///////////////////////////////////////////////////////////////////// converters
+
+void ConvertJBooleansToBools(const jboolean* jbooleans,size_t count,bool* bools) {
+    for (size_t i=0;i!=count;++i) {
+        bools[i]=(jbooleans[i]!=0);
+    }
+}
+
+void ConvertBoolsToJBooleans(const bool* bools,size_t count,jboolean* jbooleans) {
+    for (size_t i=0;i!=count;++i) {
+        jbooleans[i]=bools[i] ? JNI_TRUE : JNI_FALSE;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _BOOLCONVERTER_INCLUDED_
+#define _BOOLCONVERTER_INCLUDED_
+
+#include <stddef.h>
+#include <jni.h>
+
+///////////////////////////////////////////////////////////////////// bool converter
+
+/* Converters between jboolean and bool arrays, used by bool[]
+ *  functions when jni::JBooleanIsBool is false.
+ *
+ * Any non-zero jboolean is converted to true.
+ */
+
+/* Converts 'count' jbooleans to bools.
+ */
+void ConvertJBooleansToBools(const jboolean* jbooleans,size_t count,bool* bools);
+
+/* Converts 'count' bools to jbooleans.
+ */
+void ConvertBoolsToJBooleans(const bool* bools,size_t count,jboolean* jbooleans);
+
+/////////////////////////////////////////////////////////////////////
+
+#endif // _BOOLCONVERTER_INCLUDED_
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JNIpp.h"
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+#if !defined(__SSE2__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#   include <arm_neon.h>
+#   define JNIPP_CONVERT_NEON
+#endif
+
+/* Vector loops below handle whole blocks, the rest is converted
+ *  by scalar loops. Conversions match static_cast: floating point
+ *  conversions round to nearest, integer ones are exact.
+ */
+
+BEGIN_NAMESPACE(java)
+
+///////////////////////////////////////////////////////////////////// floating point
+
+void ConvertElements(const jdouble* in,size_t length,jfloat* out) {
+    size_t i=0;
+#if defined(__SSE2__)
+    for (;i+4<=length;i+=4) {
+        __m128 low=_mm_cvtpd_ps(_mm_loadu_pd(in+i));
+        __m128 high=_mm_cvtpd_ps(_mm_loadu_pd(in+i+2));
+        _mm_storeu_ps(out+i,_mm_movelh_ps(low,high));
+    }
+#elif defined(JNIPP_CONVERT_NEON) && defined(__aarch64__)
+    for (;i+4<=length;i+=4) {
+        float32x2_t low=vcvt_f32_f64(vld1q_f64(in+i));
+        float32x2_t high=vcvt_f32_f64(vld1q_f64(in+i+2));
+        vst1q_f32(out+i,vcombine_f32(low,high));
+    }
+#endif
+    for (;i!=length;++i) {
+        out[i]=static_cast<jfloat>(in[i]);
+    }
+}
+
+void ConvertElements(const jfloat* in,size_t length,jdouble* out) {
+    size_t i=0;
+#if defined(__SSE2__)
+    for (;i+4<=length;i+=4) {
+        __m128 v=_mm_loadu_ps(in+i);
+        _mm_storeu_pd(out+i,_mm_cvtps_pd(v));
+        _mm_storeu_pd(out+i+2,_mm_cvtps_pd(_mm_movehl_ps(v,v)));
+    }
+#elif defined(JNIPP_CONVERT_NEON) && defined(__aarch64__)
+    for (;i+4<=length;i+=4) {
+        float32x4_t v=vld1q_f32(in+i);
+        vst1q_f64(out+i,vcvt_f64_f32(vget_low_f32(v)));
+        vst1q_f64(out+i+2,vcvt_f64_f32(vget_high_f32(v)));
+    }
+#endif
+    for (;i!=length;++i) {
+        out[i]=in[i];
+    }
+}
+
+///////////////////////////////////////////////////////////////////// integers
+
+void ConvertElements(const jshort* in,size_t length,jint* out) {
+    size_t i=0;
+#if defined(__SSE2__)
+    for (;i+8<=length;i+=8) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i));
+        // Put each value into high half and shift it back with sign.
+        _mm_storeu_si128((__m128i*)(out+i),_mm_srai_epi32(_mm_unpacklo_epi16(v,v),16));
+        _mm_storeu_si128((__m128i*)(out+i+4),_mm_srai_epi32(_mm_unpackhi_epi16(v,v),16));
+    }
+#elif defined(JNIPP_CONVERT_NEON)
+    for (;i+8<=length;i+=8) {
+        int16x8_t v=vld1q_s16(in+i);
+        vst1q_s32(out+i,vmovl_s16(vget_low_s16(v)));
+        vst1q_s32(out+i+4,vmovl_s16(vget_high_s16(v)));
+    }
+#endif
+    for (;i!=length;++i) {
+        out[i]=in[i];
+    }
+}
+
+void ConvertElements(const jchar* in,size_t length,jint* out) {
+    size_t i=0;
+#if defined(__SSE2__)
+    const __m128i zero=_mm_setzero_si128();
+    for (;i+8<=length;i+=8) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i));
+        _mm_storeu_si128((__m128i*)(out+i),_mm_unpacklo_epi16(v,zero));
+        _mm_storeu_si128((__m128i*)(out+i+4),_mm_unpackhi_epi16(v,zero));
+    }
+#elif defined(JNIPP_CONVERT_NEON)
+    for (;i+8<=length;i+=8) {
+        uint16x8_t v=vld1q_u16(in+i);
+        vst1q_s32(out+i,vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))));
+        vst1q_s32(out+i+4,vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))));
+    }
+#endif
+    for (;i!=length;++i) {
+        out[i]=in[i];
+    }
+}
+
+void ConvertElements(const jint* in,size_t length,jfloat* out) {
+    size_t i=0;
+#if defined(__SSE2__)
+    for (;i+4<=length;i+=4) {
+        _mm_storeu_ps(out+i,_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in+i))));
+    }
+#elif defined(JNIPP_CONVERT_NEON)
+    for (;i+4<=length;i+=4) {
+        vst1q_f32(out+i,vcvtq_f32_s32(vld1q_s32(in+i)));
+    }
+#endif
+    for (;i!=length;++i) {
+        out[i]=static_cast<jfloat>(in[i]);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(java)
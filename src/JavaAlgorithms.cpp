@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JNIpp.h"
+#include <pthread.h>
+#include <unistd.h>
+
+BEGIN_NAMESPACE(java)
+BEGIN_NAMESPACE(algorithms)
+
+///////////////////////////////////////////////////////////////////// worker pool
+
+/* Workers are started on first ParallelFor() and live forever. They
+ *  don't touch JNI, so they don't need to be attached to the VM.
+ *
+ * Pool runs one job at a time; job chunks are taken by workers and
+ *  by the calling thread from a shared atomic counter.
+ */
+
+static const size_t MaxWorkers=7;
+
+struct Job {
+    ChunkFunction function;
+    void* context;
+    size_t length;
+    size_t chunkCount;
+    volatile size_t nextChunk;
+};
+
+static pthread_mutex_t g_poolLock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_jobStarted=PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_jobFinished=PTHREAD_COND_INITIALIZER;
+static bool g_poolStarted=false;
+static size_t g_workerCount=0;
+static Job* g_job=0;
+static unsigned g_jobGeneration=0;
+static size_t g_busyWorkers=0;
+
+/* Serializes jobs; ParallelFor() runs job inline if it's locked.
+ */
+static pthread_mutex_t g_jobLock=PTHREAD_MUTEX_INITIALIZER;
+
+static void RunChunks(Job& job) {
+    for (;;) {
+        size_t chunk=__sync_fetch_and_add(&job.nextChunk,1);
+        if (chunk>=job.chunkCount) {
+            break;
+        }
+        job.function(
+            job.context,chunk,
+            job.length*chunk/job.chunkCount,
+            job.length*(chunk+1)/job.chunkCount);
+    }
+}
+
+static void* WorkerMain(void*) {
+    unsigned generation=0;
+    for (;;) {
+        pthread_mutex_lock(&g_poolLock);
+        while (g_jobGeneration==generation) {
+            pthread_cond_wait(&g_jobStarted,&g_poolLock);
+        }
+        generation=g_jobGeneration;
+        Job* job=g_job;
+        pthread_mutex_unlock(&g_poolLock);
+
+        RunChunks(*job);
+
+        pthread_mutex_lock(&g_poolLock);
+        if (!--g_busyWorkers) {
+            pthread_cond_signal(&g_jobFinished);
+        }
+        pthread_mutex_unlock(&g_poolLock);
+    }
+    return 0;
+}
+
+/* Must be called with g_poolLock held.
+ */
+static void StartPool() {
+    if (g_poolStarted) {
+        return;
+    }
+    g_poolStarted=true;
+    long processors=sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workerCount=(processors>1) ? size_t(processors-1) : 0;
+    if (workerCount>MaxWorkers) {
+        workerCount=MaxWorkers;
+    }
+    for (size_t i=0;i!=workerCount;++i) {
+        pthread_t thread;
+        if (pthread_create(&thread,0,&WorkerMain,0)) {
+            break;
+        }
+        pthread_detach(thread);
+        g_workerCount++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////// ParallelFor
+
+size_t GetChunkCount(size_t length,size_t grain) {
+    if (!length) {
+        return 0;
+    }
+    if (!grain) {
+        grain=1;
+    }
+    size_t count=length/grain;
+    if (count<1) {
+        count=1;
+    } else if (count>MaxChunks) {
+        count=MaxChunks;
+    }
+    return count;
+}
+
+size_t GetWorkerCount() {
+    pthread_mutex_lock(&g_poolLock);
+    StartPool();
+    size_t count=g_workerCount;
+    pthread_mutex_unlock(&g_poolLock);
+    return count;
+}
+
+void ParallelFor(size_t length,size_t grain,ChunkFunction function,void* context) {
+    Job job;
+    job.function=function;
+    job.context=context;
+    job.length=length;
+    job.chunkCount=GetChunkCount(length,grain);
+    job.nextChunk=0;
+
+    if (job.chunkCount<2 || pthread_mutex_trylock(&g_jobLock)) {
+        RunChunks(job);
+        return;
+    }
+
+    pthread_mutex_lock(&g_poolLock);
+    StartPool();
+    bool useWorkers=(g_workerCount!=0);
+    if (useWorkers) {
+        // All workers wake up, but only needed ones will find chunks.
+        g_job=&job;
+        g_busyWorkers=g_workerCount;
+        g_jobGeneration++;
+        pthread_cond_broadcast(&g_jobStarted);
+    }
+    pthread_mutex_unlock(&g_poolLock);
+
+    RunChunks(job);
+
+    if (useWorkers) {
+        pthread_mutex_lock(&g_poolLock);
+        while (g_busyWorkers) {
+            pthread_cond_wait(&g_jobFinished,&g_poolLock);
+        }
+        g_job=0;
+        pthread_mutex_unlock(&g_poolLock);
+    }
+    pthread_mutex_unlock(&g_jobLock);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(algorithms)
+END_NAMESPACE(java)
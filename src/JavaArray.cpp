@@ -15,16 +15,41 @@
  */
 
 #include "JNIpp.h"
-#include "array_deleter.h"
+#include "UTFConverter.h"
+#include <stdio.h>
 
 BEGIN_NAMESPACE(java)
 
-///////////////////////////////////////////////////////////////////// PrimitiveArray
+///////////////////////////////////////////////////////////////////// helpers
+
+///////////////////////////////////////////////// array classes
 
-/* Mutex used by JNIPP_SPECIALIZE_PRIMITIVEARRAY.
+/* Array classes are resolved once and published with atomics, so
+ *  GetTypeClass() doesn't take locks after the first call. Threads
+ *  that race to resolve the class publish the first result and
+ *  release their own.
  */
-static pthreadpp::mutex g_primitiveArrayClassLock(
-    pthreadpp::mutex::initializer());
+
+static inline java::Class* LoadClass(java::Class* const& slot) {
+#if defined(__GNUC__) && (__GNUC__>4 || (__GNUC__==4 && __GNUC_MINOR__>=7))
+    return __atomic_load_n(&slot,__ATOMIC_ACQUIRE);
+#else
+    java::Class* clazz=*const_cast<java::Class* const volatile*>(&slot);
+    __sync_synchronize();
+    return clazz;
+#endif
+}
+
+static java::Class* PublishClass(java::Class*& slot,const jni::LObject& clazz) {
+    java::Class* resolved=new java::Class(clazz);
+    resolved->Retain();
+    if (!__sync_bool_compare_and_swap(&slot,(java::Class*)0,resolved)) {
+        resolved->Release();
+    }
+    return LoadClass(slot);
+}
+
+///////////////////////////////////////////////////////////////////// PrimitiveArray
 
 /* Generates implementation for PrimitiveArray specialization.
  */
@@ -37,12 +62,11 @@ static pthreadpp::mutex g_primitiveArrayClassLock(
     } \
     template<> \
     java::PClass PrimitiveArray<Type>::GetTypeClass() { \
-        pthreadpp::mutex_guard guard(g_primitiveArrayClassLock); \
-        if (!m_class) { \
-            java::PString className=new java::String("[" TypeName); \
-            m_class=java::Class::ForName(className).Detach(); \
+        java::Class* clazz=LoadClass(m_class); \
+        if (!clazz) { \
+            clazz=PublishClass(m_class,jni::FindClass("[" TypeName)); \
         } \
-        return m_class; \
+        return clazz; \
     } \
     template<> \
     void PrimitiveArray<Type>::GetRegion(jsize start,jsize length,Type* buffer) const { \
@@ -51,6 +75,26 @@ static pthreadpp::mutex g_primitiveArrayClassLock(
     template<> \
     void PrimitiveArray<Type>::SetRegion(jsize start,jsize length,const Type* elements) { \
         jni::Set##TypeTag##ArrayRegion(*this,start,length,elements); \
+    } \
+    template<> \
+    jni::LObject PrimitiveArray<Type>::NewArray(jsize length) { \
+        return jni::New##TypeTag##Array(length); \
+    } \
+    template<> \
+    void PrimitiveArray<Type>::GetRegion(const jni::AbstractObject& array,jsize start,jsize length,Type* buffer) { \
+        jni::Get##TypeTag##ArrayRegion(array,start,length,buffer); \
+    } \
+    template<> \
+    void PrimitiveArray<Type>::SetRegion(const jni::AbstractObject& array,jsize start,jsize length,const Type* elements) { \
+        jni::Set##TypeTag##ArrayRegion(array,start,length,elements); \
+    } \
+    template<> \
+    Type* PrimitiveArray<Type>::GetElements(const PrimitiveArray& array,bool* isCopy) { \
+        return jni::Get##TypeTag##ArrayElements(array,isCopy); \
+    } \
+    template<> \
+    void PrimitiveArray<Type>::ReleaseElements(const PrimitiveArray& array,Type* elements,jni::ArrayReleaseMode mode) { \
+        jni::Release##TypeTag##ArrayElements(array,elements,mode); \
     }
 
 JNIPP_SPECIALIZE_PRIMITIVEARRAY(bool,Bool,"Z")
@@ -65,41 +109,277 @@ JNIPP_SPECIALIZE_PRIMITIVEARRAY(jdouble,Double,"D")
 
 #undef JNIPP_SPECIALIZE_PRIMITIVEARRAY
 
+///////////////////////////////////////////////////////////////////// CriticalArrays
+
+const size_t CriticalArrays::MaxArrays;
+
+CriticalArrays::CriticalArrays():
+    m_count(0),
+    m_pinned(false)
+{
+}
+
+CriticalArrays::~CriticalArrays() {
+    Release();
+}
+
+size_t CriticalArrays::Add(const jni::AbstractObject& array,jsize length) {
+    if (m_pinned) {
+        jni::FatalError("CriticalArrays::Add() is called after Pin().");
+    }
+    if (m_count==MaxArrays) {
+        jni::FatalError("CriticalArrays: too many arrays (max %d).",int(MaxArrays));
+    }
+    Entry& entry=m_entries[m_count];
+    entry.array=&array;
+    entry.length=length;
+    entry.elements=0;
+    entry.isCopy=false;
+    return m_count++;
+}
+
+void CriticalArrays::Pin() {
+    if (m_pinned) {
+        return;
+    }
+    for (size_t i=0;i!=m_count;++i) {
+        Entry& entry=m_entries[i];
+        entry.elements=jni::GetPrimitiveArrayCritical(*entry.array,&entry.isCopy);
+        if (!entry.elements) {
+            // Leave critical region before translating OutOfMemoryError.
+            Unpin(i,jni::FreeElements);
+            jni::TranslateJavaException();
+        }
+    }
+    m_pinned=true;
+}
+
+void CriticalArrays::Release(bool commit) {
+    if (m_pinned) {
+        m_pinned=false;
+        Unpin(m_count,commit ? jni::CommitFreeElements : jni::FreeElements);
+    }
+}
+
+void CriticalArrays::Unpin(size_t count,jni::ArrayReleaseMode mode) {
+    while (count) {
+        Entry& entry=m_entries[--count];
+        jni::ReleasePrimitiveArrayCritical(*entry.array,entry.elements,mode);
+        entry.elements=0;
+    }
+}
+
 ///////////////////////////////////////////////////////////////////// Array
 
-/* Mutex used by InitObjectArrayClass.
+/* Function sets up object array class for a given element class.
  */
-static pthreadpp::mutex g_initObjectArrayClassLock(
-    pthreadpp::mutex::initializer());
+java::PClass InitObjectArrayClass(java::Class*& arrayClass,java::PClass (*getElementClass)()) {
+    java::Class* clazz=LoadClass(arrayClass);
+    if (clazz) {
+        return clazz;
+    }
 
-/* Function sets up object array class for a given element class.
+    // Class of an empty array is the array class. Unlike looking the
+    //  class up by name this works for element classes from any
+    //  class loader.
+    jni::LObject array=jni::NewObjectArray(0,getElementClass());
+    return PublishClass(arrayClass,jni::GetObjectClass(array));
+}
+
+///////////////////////////////////////////////////////////////////// ObjectArrayReader
+
+const jsize ObjectArrayReader::DefaultBatchSize;
+
+ObjectArrayReader::ObjectArrayReader(const jni::AbstractObject& array,jsize batchSize):
+    m_array(array),
+    m_length(jni::GetArrayLength(array)),
+    m_batchSize(batchSize>0 ? batchSize : DefaultBatchSize),
+    m_index(-1),
+    m_framePushed(false)
+{
+}
+
+ObjectArrayReader::~ObjectArrayReader() {
+    PopFrame();
+}
+
+bool ObjectArrayReader::Next() {
+    if (m_index+1>=m_length) {
+        m_index=m_length;
+        PopFrame();
+        return false;
+    }
+    ++m_index;
+    if (m_index%m_batchSize==0) {
+        PopFrame();
+        jni::PushLocalFrame(m_batchSize);
+        m_framePushed=true;
+    }
+    JNIEnv* env=jni::GetEnv();
+    jobject element=env->GetObjectArrayElement((jobjectArray)m_array.GetJObject(),m_index);
+    jni::TranslateJavaException();
+    m_element.Reset(element);
+    return true;
+}
+
+void ObjectArrayReader::PopFrame() {
+    m_element.Reset(0);
+    if (m_framePushed) {
+        m_framePushed=false;
+        jni::PopLocalFrame();
+    }
+}
+
+///////////////////////////////////////////////////////////////////// UTFStringArena
+
+const size_t UTFStringArena::NullOffset;
+
+UTFStringArena::UTFStringArena() {
+}
+
+void UTFStringArena::Clear() {
+    m_data.clear();
+    m_entries.clear();
+}
+
+void UTFStringArena::Reserve(size_t count,size_t dataSize) {
+    m_entries.reserve(count);
+    m_data.reserve(dataSize);
+}
+
+void UTFStringArena::Append(const char* string,size_t length) {
+    char* data=AppendUninitialized(length);
+    memcpy(data,string,length);
+}
+
+void UTFStringArena::AppendNull() {
+    Entry entry={NullOffset,0};
+    m_entries.push_back(entry);
+}
+
+char* UTFStringArena::AppendUninitialized(size_t length) {
+    Entry entry={m_data.size(),length};
+    m_data.resize(entry.offset+length+1);
+    m_data[entry.offset+length]=0;
+    m_entries.push_back(entry);
+    return &m_data[entry.offset];
+}
+
+///////////////////////////////////////////////// bulk conversion
+
+/* Number of array elements processed within one local frame.
  */
-java::PClass InitObjectArrayClass(java::Class*& arrayClass,java::PClass elementClass) {
-    pthreadpp::mutex_guard guard(g_initObjectArrayClassLock);
-    if (arrayClass) {
-        return arrayClass;
+static const size_t StringBatchSize=64;
+
+/* Pushes local reference frame in constructor and pops it
+ *  in destructor.
+ */
+class LocalFrameScope {
+public:
+    explicit LocalFrameScope(jint capacity) {
+        jni::PushLocalFrame(capacity);
+    }
+    ~LocalFrameScope() {
+        jni::PopLocalFrame();
     }
+};
 
-    // Get name of element class.
-    java::PString elementName=elementClass->GetName();
-    size_t elementNameLength=elementName->GetLength();
-    const jchar* elementNameChars=elementName->Get();
+void GetStrings(const StringArray& array,UTFStringArena& strings) {
+    JNIEnv* env=jni::GetEnv();
+    jobjectArray jArray=(jobjectArray)array.GetJObject();
+    size_t length=size_t(array.GetLength());
+    strings.Reserve(strings.GetCount()+length,0);
+    for (size_t start=0;start<length;start+=StringBatchSize) {
+        size_t end=std::min(length,start+StringBatchSize);
+        LocalFrameScope frame(StringBatchSize);
+        for (size_t i=start;i!=end;++i) {
+            // References are freed all at once when the frame is popped.
+            jstring jString=(jstring)env->GetObjectArrayElement(jArray,jsize(i));
+            jni::TranslateJavaException();
+            if (!jString) {
+                strings.AppendNull();
+                continue;
+            }
+            jsize stringLength=env->GetStringLength(jString);
+            const jchar* chars=env->GetStringCritical(jString,0);
+            if (!chars) {
+                jni::TranslateJavaException();
+                jni::FatalError("GetStringCritical() failed.");
+            }
+            try {
+                size_t utfLength=GetUTF8Length(chars,stringLength);
+                ConvertUTF16ToUTF8(chars,stringLength,
+                    strings.AppendUninitialized(utfLength));
+            }
+            catch (...) {
+                env->ReleaseStringCritical(jString,chars);
+                throw;
+            }
+            env->ReleaseStringCritical(jString,chars);
+        }
+    }
+}
+
+PStringArray NewStringArray(const UTFStringArena& strings) {
+    size_t count=strings.GetCount();
+    std::vector<const char*> pointers(count);
+    std::vector<size_t> lengths(count);
+    for (size_t i=0;i!=count;++i) {
+        pointers[i]=strings.GetAt(i);
+        lengths[i]=strings.GetLengthAt(i);
+    }
+    return NewStringArray(count ? &pointers[0] : 0,count ? &lengths[0] : 0,count);
+}
 
-    // Make name of array class by prepending a '['.
-    java::PString arrayName;
-    {
-        size_t length=elementNameLength+1;
-        jchar* chars=new jchar[length];
-        chars[0]='[';
-        memcpy(chars+1,elementNameChars,elementNameLength*sizeof(jchar));
+PStringArray NewStringArray(const std::vector<std::string>& strings) {
+    size_t count=strings.size();
+    std::vector<const char*> pointers(count);
+    std::vector<size_t> lengths(count);
+    for (size_t i=0;i!=count;++i) {
+        pointers[i]=strings[i].data();
+        lengths[i]=strings[i].size();
+    }
+    return NewStringArray(count ? &pointers[0] : 0,count ? &lengths[0] : 0,count);
+}
 
-        array_deleter<jchar> charsDeleter(chars);
-        arrayName=new java::String(chars,length);
+PStringArray NewStringArray(const char* const* strings,const size_t* lengths,size_t count) {
+    PStringArray array=new StringArray(jsize(count));
+    JNIEnv* env=jni::GetEnv();
+    jobjectArray jArray=(jobjectArray)array->GetJObject();
+    std::vector<jchar> chars(1);
+    for (size_t start=0;start<count;start+=StringBatchSize) {
+        size_t end=std::min(count,start+StringBatchSize);
+        LocalFrameScope frame(StringBatchSize);
+        for (size_t i=start;i!=end;++i) {
+            if (!strings[i]) {
+                // Elements of the new array are already null.
+                continue;
+            }
+            size_t maxLength=GetMaxUTF16Length(lengths[i]);
+            if (chars.size()<maxLength) {
+                chars.resize(maxLength);
+            }
+            size_t charsLength=ConvertUTF8ToUTF16(strings[i],lengths[i],&chars[0]);
+            jstring jString=env->NewString(&chars[0],jsize(charsLength));
+            jni::TranslateJavaException();
+            env->SetObjectArrayElement(jArray,jsize(i),jString);
+            jni::TranslateJavaException();
+        }
     }
+    return array;
+}
 
-    // Get array class by name.
-    arrayClass=Class::ForName(arrayName).Detach();
-    return arrayClass;
+///////////////////////////////////////////////////////////////////// MatrixArray
+
+void CheckMatrixRow(const jni::AbstractObject& row,jsize index) {
+    if (row.GetJObject()) {
+        return;
+    }
+    char message[64];
+    snprintf(message,sizeof(message),"Matrix row %d is null.",int(index));
+    jni::LObject clazz=jni::FindClass("java/lang/NullPointerException");
+    jni::GetEnv()->ThrowNew((jclass)clazz.GetJObject(),message);
+    jni::TranslateJavaException();
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -15,6 +15,8 @@
  */
 
 #include "JNIpp.h"
+#include "StringHashTable.h"
+#include <stdio.h>
 
 BEGIN_NAMESPACE(jb)
 
@@ -38,6 +40,31 @@ static bool CheckClearException(bool describe=true) {
     }
 }
 
+/* Reads value of a constant field; object values are kept as
+ *  global references forever, like classes.
+ */
+static void ReadConstantField(jclass clazz,FieldDescriptor& field) {
+    JNIEnv* env=jni::GetEnv();
+    jvalue& value=field.value;
+    switch (field.signature[0]) {
+        case 'Z': value.z=env->GetStaticBooleanField(clazz,field.id); break;
+        case 'B': value.b=env->GetStaticByteField(clazz,field.id); break;
+        case 'C': value.c=env->GetStaticCharField(clazz,field.id); break;
+        case 'S': value.s=env->GetStaticShortField(clazz,field.id); break;
+        case 'I': value.i=env->GetStaticIntField(clazz,field.id); break;
+        case 'J': value.j=env->GetStaticLongField(clazz,field.id); break;
+        case 'F': value.f=env->GetStaticFloatField(clazz,field.id); break;
+        case 'D': value.d=env->GetStaticDoubleField(clazz,field.id); break;
+        default:
+        {
+            jobject object=env->GetStaticObjectField(clazz,field.id);
+            value.l=object ? env->NewGlobalRef(object) : 0;
+            env->DeleteLocalRef(object);
+        }
+    }
+    field.isConstant=true;
+}
+
 /* jni::GetField/MethodId can throw an exception. However, the concrete
  *  exception type depends on current exception handler which may not
  *  even throw at all. So we have to use raw methods and check for
@@ -75,7 +102,7 @@ void InitClassDescriptor(ClassDescriptor& descriptor) {
         FieldDescriptor* field=descriptor.fields;
         for (;field->name;++field) {
             const char* name=field->name;
-            if (*name=='+') {
+            if (*name=='+' || *name=='=') {
                 name++;
                 field->id=jni::GetEnv()->GetStaticFieldID(jClazz,name,field->signature);
             } else {
@@ -86,6 +113,14 @@ void InitClassDescriptor(ClassDescriptor& descriptor) {
                     "Can't find field %s%s in class %s." COMMON_HINTS,
                     field->name,field->signature,descriptor.className);
             }
+            if (*field->name=='=') {
+                ReadConstantField(jClazz,*field);
+                if (CheckClearException()) {
+                    jni::FatalError(
+                        "Java exception occurred while reading field %s%s of class %s.",
+                        field->name,field->signature,descriptor.className);
+                }
+            }
         }
     }
     if (descriptor.callbacks) {
@@ -119,6 +154,195 @@ void InitClassDescriptor(ClassDescriptor& descriptor) {
     descriptor.clazz->Retain();
 }
 
+///////////////////////////////////////////////////////////////////// fields
+
+void CheckFieldType(const FieldDescriptor& descriptor,char signature,bool isStatic,
+                    const char* structName)
+{
+    const char* prefix=structName ? "Struct " : "";
+    const char* separator=structName ? ": " : "";
+    if (!structName) {
+        structName="";
+    }
+    const char* name=descriptor.name;
+    if ((*name=='+' || *name=='=')!=isStatic) {
+        jni::FatalError(
+            isStatic ? "%s%s%sField %s is not static." : "%s%s%sField %s is static.",
+            prefix,structName,separator,name);
+    }
+    char fieldSignature=descriptor.signature[0];
+    if (fieldSignature=='[') {
+        fieldSignature='L';
+    }
+    if (fieldSignature!=signature) {
+        jni::FatalError(
+            "%s%s%sType '%c' doesn't match type of field %s%s.",
+            prefix,structName,separator,signature,name,descriptor.signature);
+    }
+}
+
+///////////////////////////////////////////////////////////////////// structs
+
+/* Checks that mapped fields are instance fields of types compatible
+ *  with struct members (see CheckFieldType()). Verification is
+ *  idempotent, so it's fine if several threads do it at once.
+ */
+static void VerifyStruct(StructDescriptor& descriptor) {
+    if (descriptor.isVerified) {
+        return;
+    }
+    const StructMemberDescriptor* member=descriptor.members;
+    for (;member->read;++member) {
+        descriptor.getFieldID(member->fieldIndex);
+        CheckFieldType(
+            descriptor.fields[member->fieldIndex],
+            member->signature,false,
+            descriptor.structName);
+    }
+    __sync_synchronize();
+    descriptor.isVerified=true;
+}
+
+static void ThrowNullPointerException(const char* structName) {
+    jni::LObject clazz=jni::FindClass("java/lang/NullPointerException");
+    jni::GetEnv()->ThrowNew((jclass)clazz.GetJObject(),structName);
+    jni::TranslateJavaException();
+}
+
+static inline void ReadMembers(JNIEnv* env,StructDescriptor& descriptor,jobject object,void* value) {
+    const StructMemberDescriptor* member=descriptor.members;
+    for (;member->read;++member) {
+        member->read(env,object,descriptor.fields[member->fieldIndex].id,value);
+    }
+}
+
+static inline void WriteMembers(JNIEnv* env,StructDescriptor& descriptor,jobject object,const void* value) {
+    const StructMemberDescriptor* member=descriptor.members;
+    for (;member->read;++member) {
+        member->write(env,object,descriptor.fields[member->fieldIndex].id,value);
+    }
+}
+
+void ReadStruct(StructDescriptor& descriptor,const jni::AbstractObject& object,void* value) {
+    VerifyStruct(descriptor);
+    jobject jObject=object.GetJObject();
+    if (!jObject) {
+        ThrowNullPointerException(descriptor.structName);
+    }
+    ReadMembers(jni::GetEnv(),descriptor,jObject,value);
+}
+
+void WriteStruct(StructDescriptor& descriptor,const jni::AbstractObject& object,const void* value) {
+    VerifyStruct(descriptor);
+    jobject jObject=object.GetJObject();
+    if (!jObject) {
+        ThrowNullPointerException(descriptor.structName);
+    }
+    WriteMembers(jni::GetEnv(),descriptor,jObject,value);
+    jni::TranslateJavaException();
+}
+
+/* Range is checked up front, before anything is written to 'values'
+ *  (or to the array).
+ */
+static void CheckStructsRange(StructDescriptor& descriptor,jobjectArray array,
+                              jsize start,jsize length)
+{
+    if (!array) {
+        ThrowNullPointerException(descriptor.structName);
+    }
+    jsize arrayLength=jni::GetEnv()->GetArrayLength(array);
+    if (start>=0 && length>=0 && start<=arrayLength-length) {
+        return;
+    }
+    char message[96];
+    snprintf(message,sizeof(message),
+        "Range (start=%d, length=%d) is out of bounds of array of length %d.",
+        int(start),int(length),int(arrayLength));
+    jni::LObject clazz=jni::FindClass("java/lang/ArrayIndexOutOfBoundsException");
+    jni::GetEnv()->ThrowNew((jclass)clazz.GetJObject(),message);
+    jni::TranslateJavaException();
+}
+
+/* Elements are accessed through raw JNIEnv to avoid creating LObject
+ *  for each of them. Exceptions are checked when element is NULL.
+ */
+void ReadStructs(StructDescriptor& descriptor,const jni::AbstractObject& array,
+                 jsize start,jsize length,void* values,size_t stride)
+{
+    VerifyStruct(descriptor);
+    JNIEnv* env=jni::GetEnv();
+    jobjectArray jArray=(jobjectArray)array.GetJObject();
+    CheckStructsRange(descriptor,jArray,start,length);
+    char* value=static_cast<char*>(values);
+    for (jsize i=0;i!=length;++i,value+=stride) {
+        jobject element=env->GetObjectArrayElement(jArray,start+i);
+        if (!element) {
+            jni::TranslateJavaException();
+            ThrowNullPointerException(descriptor.structName);
+        }
+        ReadMembers(env,descriptor,element,value);
+        env->DeleteLocalRef(element);
+    }
+}
+
+void WriteStructs(StructDescriptor& descriptor,const jni::AbstractObject& array,
+                  jsize start,jsize length,const void* values,size_t stride)
+{
+    VerifyStruct(descriptor);
+    JNIEnv* env=jni::GetEnv();
+    jobjectArray jArray=(jobjectArray)array.GetJObject();
+    CheckStructsRange(descriptor,jArray,start,length);
+    const char* value=static_cast<const char*>(values);
+    for (jsize i=0;i!=length;++i,value+=stride) {
+        jobject element=env->GetObjectArrayElement(jArray,start+i);
+        if (!element) {
+            jni::TranslateJavaException();
+            ThrowNullPointerException(descriptor.structName);
+        }
+        WriteMembers(env,descriptor,element,value);
+        env->DeleteLocalRef(element);
+    }
+    jni::TranslateJavaException();
+}
+
+///////////////////////////////////////////////////////////////////// native factories
+
+/* Factories are usually registered once and looked up often, so
+ *  lookups take read lock.
+ * Table is allocated on first use (and never freed) because factories
+ *  can be registered from static initializers of other translation
+ *  units, which may run before ours.
+ */
+
+typedef StringHashTable<NativeFactoryFunction> NativeFactoryTable;
+
+static pthread_rwlock_t g_factoriesLock=PTHREAD_RWLOCK_INITIALIZER;
+
+/* Must be called with lock held. */
+static NativeFactoryTable& GetFactories() {
+    static NativeFactoryTable* factories=new NativeFactoryTable();
+    return *factories;
+}
+
+void RegisterNativeFactory(const char* name,NativeFactoryFunction factory) {
+    pthread_rwlock_wrlock(&g_factoriesLock);
+    GetFactories().Insert(name)=factory;
+    pthread_rwlock_unlock(&g_factoriesLock);
+}
+
+bool CreateNativeInstance(const char* name,const jni::LObject& object) {
+    pthread_rwlock_rdlock(&g_factoriesLock);
+    NativeFactoryFunction* entry=GetFactories().Find(name);
+    NativeFactoryFunction factory=entry ? *entry : 0;
+    pthread_rwlock_unlock(&g_factoriesLock);
+    if (!factory) {
+        return false;
+    }
+    factory(object);
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////
 
 END_NAMESPACE(jb)
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
+#include <map>
 #include "array_deleter.h"
+#include "UTFConverter.h"
 #include "JNIpp.h"
 
 BEGIN_NAMESPACE(java)
@@ -125,10 +128,15 @@ JB_DEFINE_WRAPPER_CLASS(
 
 jchar String::EmptyString[1]={0};
 char String::EmptyUTFString[1]={0};
+volatile int String::DefaultCachePolicy=String::CacheAll;
+volatile size_t String::CachedBytes=0;
 
 void String::Construct() {
+    m_cachePolicy=GetDefaultCachePolicy();
     m_string=0;
     m_utfString=0;
+    m_stringBytes=0;
+    m_utfStringBytes=0;
 }
 
 String::String():
@@ -144,13 +152,13 @@ String::String(const jchar* string):
 }
 
 String::String(const jchar* string,jint length):
-    CharSequence(NewString(string,length))
+    CharSequence(jni::NewString(string,length))
 {
     Construct();
 }
 
 String::String(const char* string):
-    CharSequence(NewStringUTF(string))
+    CharSequence(jni::NewStringUTF(string))
 {
     Construct();
 }
@@ -162,16 +170,16 @@ String::String(const jni::LObject& javaString):
 }
 
 String::~String() {
-    if (m_string!=EmptyString) {
-        delete[] m_string;
-    }
-    if (m_utfString!=EmptyUTFString) {
-        delete[] m_utfString;
-    }
+    FreeString();
+    FreeUTFString();
 }
 
 jint String::GetLength() const {
-    return jni::GetEnv()->GetStringLength((jstring)GetJObject());
+    return jni::GetStringLength(*this);
+}
+
+jint String::GetUTFLength() const {
+    return jni::GetStringUTFLength(*this);
 }
 
 const jchar* String::Get() const {
@@ -186,24 +194,61 @@ const char* String::GetUTF() const {
     return m_utfString;
 }
 
+String::CachePolicy String::GetCachePolicy() const {
+    pthreadpp::mutex_guard guard(m_lock);
+    return m_cachePolicy;
+}
+
+void String::SetCachePolicy(CachePolicy policy) {
+    pthreadpp::mutex_guard guard(m_lock);
+    m_cachePolicy=policy;
+    if (policy==CacheLast && m_string) {
+        FreeUTFString();
+    }
+}
+
+void String::DropCaches() {
+    pthreadpp::mutex_guard guard(m_lock);
+    FreeString();
+    FreeUTFString();
+}
+
+String::CachePolicy String::GetDefaultCachePolicy() {
+    return CachePolicy(DefaultCachePolicy);
+}
+
+void String::SetDefaultCachePolicy(CachePolicy policy) {
+    DefaultCachePolicy=policy;
+}
+
+size_t String::GetCachedBytes() {
+    return __sync_add_and_fetch(&CachedBytes,0);
+}
+
 void String::RetrieveString() {
     if (m_string) {
         return;
     }
-    jstring javaString=(jstring)GetJObject();
-    size_t length=jni::GetEnv()->GetStringLength(javaString);
+    if (m_cachePolicy==CacheLast) {
+        FreeUTFString();
+    }
+    jsize length=jni::GetStringLength(*this);
     if (!length) {
         m_string=EmptyString;
+    } else if (length<InlineStringLength) {
+        jni::GetStringRegion(*this,0,length,m_inlineString);
+        m_inlineString[length]=0;
+        m_string=m_inlineString;
     } else {
+        // Copy directly to our buffer, without locking string chars.
         jchar* string=new jchar[length+1];
         array_deleter<jchar> stringDeleter(string);
-        const jchar* chars=jni::GetEnv()->GetStringChars(javaString,0);
-        jni::TranslateJavaException();
-        memcpy(string,chars,sizeof(jchar)*length);
+        jni::GetStringRegion(*this,0,length,string);
         string[length]=0;
-        jni::GetEnv()->ReleaseStringChars(javaString,chars);
         m_string=string;
         stringDeleter.detach();
+        m_stringBytes=(length+1)*sizeof(jchar);
+        __sync_add_and_fetch(&CachedBytes,m_stringBytes);
     }
 }
 
@@ -211,42 +256,210 @@ void String::RetrieveUTFString() {
     if (m_utfString) {
         return;
     }
-    jstring javaString=(jstring)GetJObject();
-    jint length=jni::GetEnv()->GetStringUTFLength(javaString);
+    if (m_cachePolicy==CacheLast) {
+        FreeString();
+    }
+    jint length=jni::GetStringUTFLength(*this);
     if (!length) {
         m_utfString=EmptyUTFString;
+    } else if (length<InlineUTFStringLength) {
+        jni::GetStringUTFRegion(*this,0,jni::GetStringLength(*this),m_inlineUTFString);
+        m_inlineUTFString[length]=0;
+        m_utfString=m_inlineUTFString;
     } else {
+        // Convert directly to our buffer, without locking string chars.
         char* utfChars=new char[length+1];
         array_deleter<char> utfCharsDeleter(utfChars);
-        const char* chars=jni::GetEnv()->GetStringUTFChars(javaString,0);
-        jni::TranslateJavaException();
-        memcpy(utfChars,chars,length);
+        jni::GetStringUTFRegion(*this,0,jni::GetStringLength(*this),utfChars);
         utfChars[length]=0;
-        jni::GetEnv()->ReleaseStringUTFChars(javaString,chars);
         m_utfString=utfChars;
         utfCharsDeleter.detach();
+        m_utfStringBytes=length+1;
+        __sync_add_and_fetch(&CachedBytes,m_utfStringBytes);
+    }
+}
+
+void String::FreeString() {
+    if (m_stringBytes) {
+        delete[] m_string;
+        __sync_sub_and_fetch(&CachedBytes,m_stringBytes);
+        m_stringBytes=0;
+    }
+    m_string=0;
+}
+
+void String::FreeUTFString() {
+    if (m_utfStringBytes) {
+        delete[] m_utfString;
+        __sync_sub_and_fetch(&CachedBytes,m_utfStringBytes);
+        m_utfStringBytes=0;
+    }
+    m_utfString=0;
+}
+
+void String::GetRegion(jsize start,jsize length,jchar* buffer) const {
+    jni::GetStringRegion(*this,start,length,buffer);
+}
+
+void String::GetUTFRegion(jsize start,jsize length,char* buffer) const {
+    jni::GetStringUTFRegion(*this,start,length,buffer);
+}
+
+PString String::FromUTF8(const char* string,size_t length) {
+    // Short strings are converted on stack.
+    jchar buffer[256];
+    size_t maxLength=GetMaxUTF16Length(length);
+    jchar* heapChars=(maxLength>sizeof(buffer)/sizeof(jchar)) ?
+        new jchar[maxLength] : 0;
+    array_deleter<jchar> heapCharsDeleter(heapChars);
+    jchar* chars=heapChars ? heapChars : buffer;
+    size_t charsLength=ConvertUTF8ToUTF16(string,length,chars);
+    return PString::Wrap(jni::NewString(chars,jsize(charsLength)));
+}
+
+PString String::FromUTF8(const std::string& string) {
+    return FromUTF8(string.data(),string.size());
+}
+
+std::string String::ToUTF8() const {
+    // Conversion doesn't call #jni, so it's safe to do it while
+    //  in critical region.
+    StringCriticalView chars(*this);
+    std::string utf8(GetUTF8Length(chars.GetData(),chars.GetLength()),'\0');
+    if (!utf8.empty()) {
+        ConvertUTF16ToUTF8(chars.GetData(),chars.GetLength(),&utf8[0]);
+    }
+    return utf8;
+}
+
+/* Table of interned strings. Allocated on first use and never
+ *  destroyed, so interned strings outlive static destructors.
+ */
+typedef std::map<std::string,PString> InternTable;
+
+static pthreadpp::mutex g_internTableLock(
+    pthreadpp::mutex::initializer());
+static InternTable* g_internTable=0;
+
+/* Must be called with g_internTableLock held. */
+static const PString& InternNoLock(const char* string) {
+    if (!g_internTable) {
+        g_internTable=new InternTable();
+    }
+    InternTable::iterator interned=g_internTable->find(string);
+    if (interned==g_internTable->end()) {
+        PString instance=new String(string);
+        interned=g_internTable->insert(
+            InternTable::value_type(string,instance)).first;
+    }
+    return interned->second;
+}
+
+const PString& String::Intern(const char* string) {
+    pthreadpp::mutex_guard guard(g_internTableLock);
+    return InternNoLock(string);
+}
+
+/* Cache of interned literals, keyed by literal address. Open
+ *  addressing with linear probing; entries are added (under
+ *  g_internTableLock) but never removed, so readers don't lock.
+ *  Writers store string before publishing literal. When probing
+ *  limit is reached literal is not cached and goes to Intern().
+ */
+struct InternedLiteral {
+    const char* volatile literal;
+    const PString* volatile string;
+};
+
+static const uint32_t InternedLiteralBits=10;
+static const size_t InternedLiteralCount=size_t(1)<<InternedLiteralBits;
+static const size_t MaxInternedLiteralProbes=16;
+
+static InternedLiteral g_internedLiterals[InternedLiteralCount];
+
+static size_t HashLiteral(const char* literal) {
+    uint32_t hash=uint32_t(uintptr_t(literal))*2654435761u;
+    return hash>>(32-InternedLiteralBits);
+}
+
+const PString& String::InternLiteral(const char* literal) {
+    size_t index=HashLiteral(literal);
+    for (size_t probe=0;probe!=MaxInternedLiteralProbes;++probe) {
+        const InternedLiteral& entry=g_internedLiterals[index];
+        const char* key=entry.literal;
+        if (key==literal) {
+            __sync_synchronize();
+            return *entry.string;
+        }
+        if (!key) {
+            break;
+        }
+        index=(index+1) & (InternedLiteralCount-1);
     }
+
+    pthreadpp::mutex_guard guard(g_internTableLock);
+    const PString& string=InternNoLock(literal);
+    index=HashLiteral(literal);
+    for (size_t probe=0;probe!=MaxInternedLiteralProbes;++probe) {
+        InternedLiteral& entry=g_internedLiterals[index];
+        if (entry.literal==literal) {
+            break;
+        }
+        if (!entry.literal) {
+            entry.string=&string;
+            __sync_synchronize();
+            entry.literal=literal;
+            break;
+        }
+        index=(index+1) & (InternedLiteralCount-1);
+    }
+    return string;
 }
 
 jni::LObject String::NewString(const jchar* string) {
     const jchar* end=string;
     while (*end) end++;
-    return NewString(string,jint(end-string));
+    return jni::NewString(string,jsize(end-string));
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////////////////////////// StringCharsView
+
+StringCharsView::StringCharsView(const jni::AbstractObject& string):
+    m_string(string),
+    m_chars(0),
+    m_length(0),
+    m_isCopy(false)
+{
+    m_length=jni::GetStringLength(m_string);
+    m_chars=jni::GetStringChars(m_string,&m_isCopy);
 }
 
-jni::LObject String::NewString(const jchar* string,jint length) {
-    jobject result=jni::GetEnv()->NewString(string,length);
-    jni::TranslateJavaException();
-    return jni::LObject::WrapLocal(result);
+StringCharsView::~StringCharsView() {
+    if (m_chars) {
+        jni::ReleaseStringChars(m_string,m_chars);
+    }
 }
 
-jni::LObject String::NewStringUTF(const char* string) {
-    jobject result=jni::GetEnv()->NewStringUTF(string);
-    jni::TranslateJavaException();
-    return jni::LObject::WrapLocal(result);
+///////////////////////////////////////////////////////////////////// StringCriticalView
+
+StringCriticalView::StringCriticalView(const jni::AbstractObject& string):
+    m_string(string),
+    m_chars(0),
+    m_length(0),
+    m_isCopy(false)
+{
+    // Length must be retrieved before entering critical region.
+    m_length=jni::GetStringLength(m_string);
+    m_chars=jni::GetStringCritical(m_string,&m_isCopy);
 }
 
-#undef JB_CURRENT_CLASS
+StringCriticalView::~StringCriticalView() {
+    if (m_chars) {
+        jni::ReleaseStringCritical(m_string,m_chars);
+    }
+}
 
 ///////////////////////////////////////////////////////////////////// Throwable
 
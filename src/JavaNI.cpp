@@ -15,7 +15,11 @@
  */
 
 #include "JNIpp.h"
+#include "BoolConverter.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #ifdef ANDROID
 #    include <android/log.h>
@@ -47,6 +51,47 @@ static void ThrowRuntimeException(const char* message) {
 
 #undef JB_CURRENT_CLASS
 
+///////////////////////////////////////////////// critical regions
+
+/* In debug builds number of critical regions entered by the current
+ *  thread is tracked, and GetEnv() fails if it's not zero. Functions
+ *  that enter and leave critical regions use GetEnv(bool) which
+ *  doesn't check.
+ */
+
+#ifndef NDEBUG
+
+static pthread_key_t g_criticalDepthKey;
+static pthread_once_t g_criticalDepthKeyOnce=PTHREAD_ONCE_INIT;
+
+static void CreateCriticalDepthKey() {
+    pthread_key_create(&g_criticalDepthKey,0);
+}
+
+static intptr_t GetCriticalDepth() {
+    pthread_once(&g_criticalDepthKeyOnce,CreateCriticalDepthKey);
+    return (intptr_t)pthread_getspecific(g_criticalDepthKey);
+}
+
+static void AdjustCriticalDepth(intptr_t delta) {
+    intptr_t depth=GetCriticalDepth()+delta;
+    pthread_setspecific(g_criticalDepthKey,(void*)depth);
+}
+
+#endif // NDEBUG
+
+static inline void EnterCritical() {
+#ifndef NDEBUG
+    AdjustCriticalDepth(1);
+#endif
+}
+
+static inline void LeaveCritical() {
+#ifndef NDEBUG
+    AdjustCriticalDepth(-1);
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////// LObject
 
 LObject::LObject() {
@@ -160,6 +205,11 @@ static JNIEnv* GetEnv(bool fail) {
 }
 
 JNIEnv* GetEnv() {
+#ifndef NDEBUG
+    if (GetCriticalDepth()) {
+        FatalError("jni:: function is called inside a critical region.");
+    }
+#endif
     return GetEnv(true);
 }
 
@@ -226,6 +276,24 @@ void TranslateCppException() {
     }
 }
 
+///////////////////////////////////////////////////////////////////// local references
+
+void PushLocalFrame(jint capacity) {
+    if (GetEnv()->PushLocalFrame(capacity)<0) {
+        TranslateJavaException();
+        FatalError("PushLocalFrame(%d) failed.",capacity);
+    }
+}
+
+LObject PopLocalFrame(const AbstractObject& result) {
+    jobject object=GetEnv()->PopLocalFrame(result.GetJObject());
+    return LObject::WrapLocal(object);
+}
+
+void PopLocalFrame() {
+    GetEnv()->PopLocalFrame(0);
+}
+
 ///////////////////////////////////////////////////////////////////// classes & objects
 
 LObject FindClass(const char* className) {
@@ -374,6 +442,115 @@ JNIPP_IMPLEMENT_NVCALL_METHOD(jdouble,_CallNonvirtualDoubleMethod,CallNonvirtual
 JNIPP_IMPLEMENT_NVCALL_VOID_METHOD(_CallNonvirtualVoidMethod,CallNonvirtualVoidMethod);
 
 
+///////////////////////////////////////////////////////////////////// strings
+
+LObject NewString(const jchar* chars,jsize length) {
+    jstring string=GetEnv()->NewString(chars,length);
+    TranslateJavaException();
+    return LObject::WrapLocal(string);
+}
+
+jsize GetStringLength(const AbstractObject& string) {
+    jstring jString=(jstring)string.GetJObject();
+    return GetEnv()->GetStringLength(jString);
+}
+
+const jchar* GetStringChars(const AbstractObject& string,bool* isCopy) {
+    jstring jString=(jstring)string.GetJObject();
+    jboolean jIsCopy=JNI_FALSE;
+    const jchar* chars=GetEnv()->GetStringChars(jString,&jIsCopy);
+    TranslateJavaException();
+    if (isCopy) {
+        *isCopy=(jIsCopy==JNI_TRUE);
+    }
+    return chars;
+}
+
+void ReleaseStringChars(const AbstractObject& string,const jchar* chars) {
+    jstring jString=(jstring)string.GetJObject();
+    GetEnv()->ReleaseStringChars(jString,chars);
+}
+
+LObject NewStringUTF(const char* chars) {
+    jstring string=GetEnv()->NewStringUTF(chars);
+    TranslateJavaException();
+    return LObject::WrapLocal(string);
+}
+
+jsize GetStringUTFLength(const AbstractObject& string) {
+    jstring jString=(jstring)string.GetJObject();
+    return GetEnv()->GetStringUTFLength(jString);
+}
+
+const char* GetStringUTFChars(const AbstractObject& string,bool* isCopy) {
+    jstring jString=(jstring)string.GetJObject();
+    jboolean jIsCopy=JNI_FALSE;
+    const char* chars=GetEnv()->GetStringUTFChars(jString,&jIsCopy);
+    TranslateJavaException();
+    if (isCopy) {
+        *isCopy=(jIsCopy==JNI_TRUE);
+    }
+    return chars;
+}
+
+void ReleaseStringUTFChars(const AbstractObject& string,const char* chars) {
+    jstring jString=(jstring)string.GetJObject();
+    GetEnv()->ReleaseStringUTFChars(jString,chars);
+}
+
+void GetStringRegion(const AbstractObject& string,jsize start,jsize length,jchar* buffer) {
+    jstring jString=(jstring)string.GetJObject();
+    GetEnv()->GetStringRegion(jString,start,length,buffer);
+    TranslateJavaException();
+}
+
+void GetStringUTFRegion(const AbstractObject& string,jsize start,jsize length,char* buffer) {
+    jstring jString=(jstring)string.GetJObject();
+    GetEnv()->GetStringUTFRegion(jString,start,length,buffer);
+    TranslateJavaException();
+}
+
+const jchar* GetStringCritical(const AbstractObject& string,bool* isCopy) {
+    jstring jString=(jstring)string.GetJObject();
+    jboolean jIsCopy=JNI_FALSE;
+    const jchar* chars=GetEnv(true)->GetStringCritical(jString,&jIsCopy);
+    if (!chars) {
+        // GetStringCritical() returns NULL only when it fails to
+        //  allocate a copy, in which case OutOfMemoryError is pending.
+        TranslateJavaException();
+    }
+    EnterCritical();
+    if (isCopy) {
+        *isCopy=(jIsCopy==JNI_TRUE);
+    }
+    return chars;
+}
+
+void ReleaseStringCritical(const AbstractObject& string,const jchar* chars) {
+    jstring jString=(jstring)string.GetJObject();
+    LeaveCritical();
+    GetEnv(true)->ReleaseStringCritical(jString,chars);
+}
+
+///////////////////////////////////////////////////////////////////// direct buffers
+
+LObject NewDirectByteBuffer(void* address,jlong capacity) {
+    jobject buffer=GetEnv()->NewDirectByteBuffer(address,capacity);
+    TranslateJavaException();
+    if (!buffer) {
+        FatalError("NewDirectByteBuffer() failed, VM doesn't support direct buffers.");
+    }
+    return LObject::WrapLocal(buffer);
+}
+
+void* GetDirectBufferAddress(const AbstractObject& buffer) {
+    return GetEnv()->GetDirectBufferAddress(buffer.GetJObject());
+}
+
+jlong GetDirectBufferCapacity(const AbstractObject& buffer) {
+    return GetEnv()->GetDirectBufferCapacity(buffer.GetJObject());
+}
+
 ///////////////////////////////////////////////////////////////////// arrays
 
 ///////////////////////////////////////////////// object array
@@ -383,6 +560,30 @@ jsize GetArrayLength(const AbstractObject& array) {
     return GetEnv()->GetArrayLength(jArray);
 }
 
+void* GetPrimitiveArrayCritical(const AbstractObject& array,bool* isCopy) {
+    jarray jArray=(jarray)array.GetJObject();
+    jboolean jIsCopy=JNI_FALSE;
+    void* elements=GetEnv(true)->GetPrimitiveArrayCritical(jArray,&jIsCopy);
+    if (!elements) {
+        // Leave OutOfMemoryError pending, caller may be in another
+        //  critical region.
+        return 0;
+    }
+    EnterCritical();
+    if (isCopy) {
+        *isCopy=(jIsCopy==JNI_TRUE);
+    }
+    return elements;
+}
+
+void ReleasePrimitiveArrayCritical(const AbstractObject& array,void* elements,ArrayReleaseMode mode) {
+    jarray jArray=(jarray)array.GetJObject();
+    if (mode!=CommitElements) {
+        LeaveCritical();
+    }
+    GetEnv(true)->ReleasePrimitiveArrayCritical(jArray,elements,mode);
+}
+
 LObject NewObjectArray(jsize length,const AbstractObject& elementClass) {
     return NewObjectArray(length,elementClass,LObject());
 }
@@ -417,6 +618,71 @@ LObject NewBoolArray(jsize length) {
     return LObject::WrapLocal(array);
 }
 
+/* When bool differs from jboolean, GetBoolArrayElements() returns
+ *  converted copy of the elements stored in a BoolBlock. The block
+ *  remembers original elements so that ReleaseBoolArrayElements()
+ *  can convert changes back and release them. A few small blocks are
+ *  kept in a pool for reuse.
+ */
+struct BoolBlock {
+    BoolBlock* next;
+    size_t capacity;
+    jboolean* elements;
+    jsize length;
+
+    bool* GetBools() {
+        return reinterpret_cast<bool*>(this+1);
+    }
+    static BoolBlock* FromBools(bool* bools) {
+        return reinterpret_cast<BoolBlock*>(bools)-1;
+    }
+};
+
+static const size_t MaxPooledBoolBlocks=4;
+static const size_t MaxPooledBoolBlockCapacity=64*1024;
+
+static pthreadpp::mutex g_boolBlockPoolLock(
+    pthreadpp::mutex::initializer());
+static BoolBlock* g_boolBlockPool=0;
+static size_t g_boolBlockPoolSize=0;
+
+static BoolBlock* AcquireBoolBlock(size_t capacity) {
+    {
+        pthreadpp::mutex_guard guard(g_boolBlockPoolLock);
+        for (BoolBlock** link=&g_boolBlockPool;*link;link=&(*link)->next) {
+            BoolBlock* block=*link;
+            if (block->capacity>=capacity) {
+                *link=block->next;
+                g_boolBlockPoolSize--;
+                return block;
+            }
+        }
+    }
+    BoolBlock* block=(BoolBlock*)malloc(sizeof(BoolBlock)+capacity*sizeof(bool));
+    if (!block) {
+        FatalError("Failed to allocate %d bools.",int(capacity));
+    }
+    block->capacity=capacity;
+    return block;
+}
+
+static void ReleaseBoolBlock(BoolBlock* block) {
+    if (block->capacity<=MaxPooledBoolBlockCapacity) {
+        pthreadpp::mutex_guard guard(g_boolBlockPoolLock);
+        if (g_boolBlockPoolSize<MaxPooledBoolBlocks) {
+            block->next=g_boolBlockPool;
+            g_boolBlockPool=block;
+            g_boolBlockPoolSize++;
+            return;
+        }
+    }
+    free(block);
+}
+
+/* Size of the stack buffer used by region functions.
+ */
+static const jsize BoolRegionChunk=512;
+
 bool* GetBoolArrayElements(const AbstractObject& array,bool* isCopy) {
     jbooleanArray jArray=(jbooleanArray)array.GetJObject();
     jboolean jIsCopy=JNI_FALSE;
@@ -426,7 +692,17 @@ bool* GetBoolArrayElements(const AbstractObject& array,bool* isCopy) {
         TranslateJavaException();
         result=(bool*)elements;
     } else {
-        FatalError("jni::GetBoolArrayElements is not implemented yet.");
+        JNIEnv* env=GetEnv();
+        jsize length=env->GetArrayLength(jArray);
+        jboolean* elements=env->GetBooleanArrayElements(jArray,0);
+        TranslateJavaException();
+        BoolBlock* block=AcquireBoolBlock(length);
+        block->elements=elements;
+        block->length=length;
+        result=block->GetBools();
+        ConvertJBooleansToBools(elements,length,result);
+        // Caller always gets a converted copy.
+        jIsCopy=JNI_TRUE;
     }
     if (isCopy) {
         *isCopy=(jIsCopy==JNI_TRUE);
@@ -439,7 +715,14 @@ void ReleaseBoolArrayElements(const AbstractObject& array,bool* elements,jint mo
     if (JBooleanIsBool) {
         GetEnv()->ReleaseBooleanArrayElements(jArray,(jboolean*)elements,mode);
     } else {
-        FatalError("jni::ReleaseBoolArrayElements is not implemented yet.");
+        BoolBlock* block=BoolBlock::FromBools(elements);
+        if (mode!=JNI_ABORT) {
+            ConvertBoolsToJBooleans(elements,block->length,block->elements);
+        }
+        GetEnv()->ReleaseBooleanArrayElements(jArray,block->elements,mode);
+        if (mode!=JNI_COMMIT) {
+            ReleaseBoolBlock(block);
+        }
     }
 }
 
@@ -447,8 +730,19 @@ void GetBoolArrayRegion(const AbstractObject& array,jsize start,jsize length,boo
     jbooleanArray jArray=(jbooleanArray)array.GetJObject();
     if (JBooleanIsBool) {
         GetEnv()->GetBooleanArrayRegion(jArray,start,length,(jboolean*)buffer);
+        TranslateJavaException();
     } else {
-        FatalError("jni::GetBoolArrayRegion is not implemented yet.");
+        JNIEnv* env=GetEnv();
+        jboolean chunk[BoolRegionChunk];
+        while (length>0) {
+            jsize chunkLength=std::min(length,BoolRegionChunk);
+            env->GetBooleanArrayRegion(jArray,start,chunkLength,chunk);
+            TranslateJavaException();
+            ConvertJBooleansToBools(chunk,chunkLength,buffer);
+            start+=chunkLength;
+            buffer+=chunkLength;
+            length-=chunkLength;
+        }
     }
 }
 
@@ -456,8 +750,19 @@ void SetBoolArrayRegion(const AbstractObject& array,jsize start,jsize length,con
     jbooleanArray jArray=(jbooleanArray)array.GetJObject();
     if (JBooleanIsBool) {
         GetEnv()->SetBooleanArrayRegion(jArray,start,length,(const jboolean*)buffer);
+        TranslateJavaException();
     } else {
-        FatalError("jni::SetBoolArrayRegion is not implemented yet.");
+        JNIEnv* env=GetEnv();
+        jboolean chunk[BoolRegionChunk];
+        while (length>0) {
+            jsize chunkLength=std::min(length,BoolRegionChunk);
+            ConvertBoolsToJBooleans(buffer,chunkLength,chunk);
+            env->SetBooleanArrayRegion(jArray,start,chunkLength,chunk);
+            TranslateJavaException();
+            start+=chunkLength;
+            buffer+=chunkLength;
+            length-=chunkLength;
+        }
     }
 }
 
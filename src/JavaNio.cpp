@@ -0,0 +1,749 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JNIpp.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <limits.h>
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#   include <linux/futex.h>
+#endif
+
+BEGIN_NAMESPACE(java)
+BEGIN_NAMESPACE(nio)
+
+///////////////////////////////////////////////////////////////////// Buffer
+
+#define JB_CURRENT_CLASS Buffer
+
+JB_DEFINE_WRAPPER_CLASS(
+    "java/nio/Buffer"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        Capacity,
+        "capacity","()I"
+    )
+    (
+        Position,
+        "position","()I"
+    )
+    (
+        SetPosition,
+        "position","(I)Ljava/nio/Buffer;"
+    )
+    (
+        Limit,
+        "limit","()I"
+    )
+    (
+        SetLimit,
+        "limit","(I)Ljava/nio/Buffer;"
+    )
+    (
+        IsDirect,
+        "isDirect","()Z"
+    )
+)
+
+Buffer::Buffer(const jni::LObject& buffer):
+    Object(buffer)
+{
+}
+
+jint Buffer::GetCapacity() const {
+    return JB_CALL_THIS(IntMethod,Capacity);
+}
+
+jint Buffer::GetPosition() const {
+    return JB_CALL_THIS(IntMethod,Position);
+}
+
+void Buffer::SetPosition(jint position) {
+    JB_CALL_THIS(ObjectMethod,SetPosition,position);
+}
+
+jint Buffer::GetLimit() const {
+    return JB_CALL_THIS(IntMethod,Limit);
+}
+
+void Buffer::SetLimit(jint limit) {
+    JB_CALL_THIS(ObjectMethod,SetLimit,limit);
+}
+
+bool Buffer::IsDirect() const {
+    return JB_CALL_THIS(BooleanMethod,IsDirect);
+}
+
+void* Buffer::GetDirectAddress() const {
+    return jni::GetDirectBufferAddress(*this);
+}
+
+jlong Buffer::GetDirectCapacity() const {
+    return jni::GetDirectBufferCapacity(*this);
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////////////////////////// TypedBuffer
+
+/* Mutex used by JNIPP_SPECIALIZE_TYPEDBUFFER.
+ */
+static pthreadpp::mutex g_typedBufferClassLock(
+    pthreadpp::mutex::initializer());
+
+/* Generates implementation for TypedBuffer specialization.
+ */
+#define JNIPP_SPECIALIZE_TYPEDBUFFER(Type,ClassName) \
+    template<> \
+    java::PClass TypedBuffer<Type>::GetTypeClass() { \
+        pthreadpp::mutex_guard guard(g_typedBufferClassLock); \
+        if (!m_class) { \
+            m_class=java::Class::ForName(ClassName).Detach(); \
+        } \
+        return m_class; \
+    }
+
+JNIPP_SPECIALIZE_TYPEDBUFFER(jint,"java.nio.IntBuffer")
+JNIPP_SPECIALIZE_TYPEDBUFFER(jfloat,"java.nio.FloatBuffer")
+JNIPP_SPECIALIZE_TYPEDBUFFER(jdouble,"java.nio.DoubleBuffer")
+
+#undef JNIPP_SPECIALIZE_TYPEDBUFFER
+
+///////////////////////////////////////////////////////////////////// ByteOrder
+
+#define JB_CURRENT_CLASS ByteOrder
+
+JB_DEFINE_ACCESSOR(
+    "java/nio/ByteOrder"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        NativeOrder,
+        "+nativeOrder","()Ljava/nio/ByteOrder;"
+    )
+)
+
+static jni::LObject GetNativeByteOrder() {
+    return JB_CALL_STATIC(ObjectMethod,NativeOrder);
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////////////////////////// ByteBuffer
+
+#define JB_CURRENT_CLASS ByteBuffer
+
+JB_DEFINE_WRAPPER_CLASS(
+    "java/nio/ByteBuffer"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        AllocateDirect,
+        "+allocateDirect","(I)Ljava/nio/ByteBuffer;"
+    )
+    (
+        Duplicate,
+        "duplicate","()Ljava/nio/ByteBuffer;"
+    )
+    (
+        Order,
+        "order","(Ljava/nio/ByteOrder;)Ljava/nio/ByteBuffer;"
+    )
+    (
+        AsIntBuffer,
+        "asIntBuffer","()Ljava/nio/IntBuffer;"
+    )
+    (
+        AsFloatBuffer,
+        "asFloatBuffer","()Ljava/nio/FloatBuffer;"
+    )
+    (
+        AsDoubleBuffer,
+        "asDoubleBuffer","()Ljava/nio/DoubleBuffer;"
+    )
+    (
+        AsReadOnlyBuffer,
+        "asReadOnlyBuffer","()Ljava/nio/ByteBuffer;"
+    )
+)
+
+ByteBuffer::ByteBuffer(void* address,jlong capacity):
+    Buffer(jni::NewDirectByteBuffer(address,capacity))
+{
+}
+
+ByteBuffer::ByteBuffer(const jni::LObject& buffer):
+    Buffer(buffer)
+{
+}
+
+PByteBuffer ByteBuffer::AllocateDirect(jint capacity) {
+    return PByteBuffer::Wrap(JB_CALL_STATIC(ObjectMethod,AllocateDirect,capacity));
+}
+
+void ByteBuffer::SetNativeOrder() {
+    JB_CALL_THIS(ObjectMethod,Order,GetNativeByteOrder());
+}
+
+jni::LObject ByteBuffer::DuplicateInNativeOrder() const {
+    jni::LObject duplicate=JB_CALL_THIS(ObjectMethod,Duplicate);
+    JB_CALL(ObjectMethod,duplicate,Order,GetNativeByteOrder());
+    return duplicate;
+}
+
+PIntBuffer ByteBuffer::AsIntBuffer() const {
+    return PIntBuffer::Wrap(JB_CALL(ObjectMethod,DuplicateInNativeOrder(),AsIntBuffer));
+}
+
+PFloatBuffer ByteBuffer::AsFloatBuffer() const {
+    return PFloatBuffer::Wrap(JB_CALL(ObjectMethod,DuplicateInNativeOrder(),AsFloatBuffer));
+}
+
+PDoubleBuffer ByteBuffer::AsDoubleBuffer() const {
+    return PDoubleBuffer::Wrap(JB_CALL(ObjectMethod,DuplicateInNativeOrder(),AsDoubleBuffer));
+}
+
+PByteBuffer ByteBuffer::AsReadOnlyBuffer() const {
+    return PByteBuffer::Wrap(JB_CALL_THIS(ObjectMethod,AsReadOnlyBuffer));
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////////////////////////// MappedFile
+
+///////////////////////////////////////////////// IOException
+
+#define JB_CURRENT_CLASS IOException
+
+JB_DEFINE_ACCESSOR(
+    "java/io/IOException"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        Constructor,
+        "<init>","(Ljava/lang/String;)V"
+    )
+)
+
+/* Throws java.io.IOException with message built from 'what', 'path'
+ *  (ignored if NULL) and 'error' (errno value, ignored if 0).
+ */
+static void ThrowIOException(const char* what,const char* path,int error) {
+    char message[512];
+    int length=snprintf(message,sizeof(message),"%s",what);
+    if (path && length<(int)sizeof(message)) {
+        length+=snprintf(message+length,sizeof(message)-length," '%s'",path);
+    }
+    if (error && length<(int)sizeof(message)) {
+        snprintf(message+length,sizeof(message)-length,": %s",strerror(error));
+    }
+    throw PException::Wrap(JB_NEW(Constructor,PString::New(message)));
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////// file channels
+
+#define JB_CURRENT_CLASS RandomAccessFile
+
+JB_DEFINE_ACCESSOR(
+    "java/io/RandomAccessFile"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        Constructor,
+        "<init>","(Ljava/lang/String;Ljava/lang/String;)V"
+    )
+    (
+        GetChannel,
+        "getChannel","()Ljava/nio/channels/FileChannel;"
+    )
+    (
+        Close,
+        "close","()V"
+    )
+)
+
+static jni::LObject OpenRandomAccessFile(const char* path,bool writable) {
+    return JB_NEW(Constructor,PString::New(path),PString::New(writable ? "rw" : "r"));
+}
+
+static jni::LObject GetFileChannel(const jni::LObject& file) {
+    return JB_CALL(ObjectMethod,file,GetChannel);
+}
+
+static void CloseRandomAccessFile(const jni::LObject& file) {
+    JB_CALL(VoidMethod,file,Close);
+}
+
+#undef JB_CURRENT_CLASS
+
+#define JB_CURRENT_CLASS FileChannel
+
+JB_DEFINE_ACCESSOR(
+    "java/nio/channels/FileChannel"
+    ,
+    NoFields
+    ,
+    Methods
+    (
+        Size,
+        "size","()J"
+    )
+    (
+        Map,
+        "map","(Ljava/nio/channels/FileChannel$MapMode;JJ)Ljava/nio/MappedByteBuffer;"
+    )
+)
+
+static jlong GetChannelSize(const jni::LObject& channel) {
+    return JB_CALL(LongMethod,channel,Size);
+}
+
+static jni::LObject MapChannel(const jni::LObject& channel,const jni::LObject& mode,jlong offset,jlong length) {
+    return JB_CALL(ObjectMethod,channel,Map,mode,offset,length);
+}
+
+#undef JB_CURRENT_CLASS
+
+#define JB_CURRENT_CLASS MapMode
+
+JB_DEFINE_ACCESSOR(
+    "java/nio/channels/FileChannel$MapMode"
+    ,
+    Fields
+    (
+        ReadOnly,
+        "+READ_ONLY","Ljava/nio/channels/FileChannel$MapMode;"
+    )
+    (
+        ReadWrite,
+        "+READ_WRITE","Ljava/nio/channels/FileChannel$MapMode;"
+    )
+    (
+        Private,
+        "+PRIVATE","Ljava/nio/channels/FileChannel$MapMode;"
+    )
+    ,
+    NoMethods
+)
+
+static jni::LObject GetMapMode(MappedFile::Mode mode) {
+    switch (mode) {
+        case MappedFile::ReadWrite: return JB_GET_STATIC(ObjectField,ReadWrite);
+        case MappedFile::Private: return JB_GET_STATIC(ObjectField,Private);
+        default: return JB_GET_STATIC(ObjectField,ReadOnly);
+    }
+}
+
+#undef JB_CURRENT_CLASS
+
+///////////////////////////////////////////////// implementation
+
+static int ToMadviseAdvice(MappedFile::Advice advice) {
+    switch (advice) {
+        case MappedFile::AdviseSequential: return MADV_SEQUENTIAL;
+        case MappedFile::AdviseRandom: return MADV_RANDOM;
+        case MappedFile::AdviseWillNeed: return MADV_WILLNEED;
+        case MappedFile::AdviseDontNeed: return MADV_DONTNEED;
+        default: return MADV_NORMAL;
+    }
+}
+
+/* madvise() and msync() require page-aligned address, so 'data'
+ *  is extended to the start of its page.
+ */
+static void* GetPageStart(jbyte* data,size_t* length) {
+    uintptr_t pageSize=uintptr_t(sysconf(_SC_PAGESIZE));
+    uintptr_t alignment=uintptr_t(data) % pageSize;
+    *length+=size_t(alignment);
+    return data-alignment;
+}
+
+MappedFile::MappedFile(const char* path,Mode mode,Advice advice):
+    m_mode(mode),
+    m_data(0),m_length(0)
+{
+    Map(path,0,0,true,advice);
+}
+
+MappedFile::MappedFile(const char* path,jlong offset,size_t length,Mode mode,Advice advice):
+    m_mode(mode),
+    m_data(0),m_length(0)
+{
+    Map(path,offset,length,false,advice);
+}
+
+MappedFile::~MappedFile() {
+}
+
+void MappedFile::Map(const char* path,jlong offset,size_t length,bool wholeFile,Advice advice) {
+    if (offset<0) {
+        jni::FatalError("MappedFile: negative offset %lld.",(long long)offset);
+    }
+    bool writable=(m_mode!=ReadOnly);
+    if (writable && access(path,F_OK)==-1) {
+        /* RandomAccessFile would create missing file. */
+        ThrowIOException("Can't open",path,errno);
+    }
+    jni::LObject file=OpenRandomAccessFile(path,writable);
+    jni::LObject buffer;
+    try {
+        jni::LObject channel=GetFileChannel(file);
+        if (wholeFile) {
+            jlong size=GetChannelSize(channel);
+            if (size>0x7FFFFFFF) {
+                ThrowIOException("File is too large for a buffer",path,0);
+            }
+            length=size_t(size);
+        } else if (length>0x7FFFFFFF) {
+            ThrowIOException("Mapping is too large for a buffer",path,0);
+        }
+        if (length) {
+            buffer=MapChannel(channel,GetMapMode(m_mode),offset,jlong(length));
+        }
+    }
+    catch (...) {
+        CloseRandomAccessFile(file);
+        throw;
+    }
+    // Mapping stays valid after the file is closed.
+    CloseRandomAccessFile(file);
+
+    if (!length) {
+        /* Can't create direct buffer for NULL address. */
+        m_buffer=ByteBuffer::AllocateDirect(0);
+        return;
+    }
+    m_buffer=new ByteBuffer(buffer);
+    m_data=m_buffer->GetData();
+    m_length=length;
+    if (advice!=AdviseNormal) {
+        Advise(advice);
+    }
+}
+
+PByteBuffer MappedFile::GetBuffer() const {
+    return m_buffer;
+}
+
+void MappedFile::Advise(Advice advice) {
+    if (m_data) {
+        size_t length=m_length;
+        madvise(GetPageStart(m_data,&length),length,ToMadviseAdvice(advice));
+    }
+}
+
+void MappedFile::Sync() {
+    if (m_data && m_mode==ReadWrite) {
+        size_t length=m_length;
+        msync(GetPageStart(m_data,&length),length,MS_SYNC);
+    }
+}
+
+///////////////////////////////////////////////////////////////////// RingBuffer
+
+///////////////////////////////////////////////// layout
+
+/* Header layout, must match com.itoa.jnipp.RingBuffer.
+ * Positions are free-running counters (modulo 2^32), so ring is
+ *  empty when they are equal and full when they differ by capacity.
+ * Each position shares cache line with the flag its owner reads,
+ *  but not with the other position.
+ */
+static const jint WritePositionOffset=0;
+static const jint ReaderWaitingOffset=4;
+static const jint ReadPositionOffset=64;
+static const jint WriterWaitingOffset=68;
+static const jint CapacityOffset=128;
+
+const jint RingBuffer::HeaderSize;
+
+///////////////////////////////////////////////// futex
+
+/* Blocks while '*address' equals 'expected', but no longer than
+ *  'timeoutMillis' (negative means forever). May return spuriously.
+ */
+static void FutexWait(volatile jint* address,jint expected,jlong timeoutMillis) {
+#if defined(__linux__)
+    struct timespec timeout;
+    struct timespec* timeoutPointer=0;
+    if (timeoutMillis>=0) {
+        timeout.tv_sec=time_t(timeoutMillis/1000);
+        timeout.tv_nsec=long(timeoutMillis%1000)*1000000;
+        timeoutPointer=&timeout;
+    }
+    syscall(__NR_futex,(jint*)address,FUTEX_WAIT,expected,timeoutPointer,0,0);
+#else
+    /* No futexes, just sleep a bit. */
+    if (*address==expected && timeoutMillis!=0) {
+        struct timespec pause={0,1000000};
+        nanosleep(&pause,0);
+    }
+#endif
+}
+
+static void FutexWake(volatile jint* address) {
+#if defined(__linux__)
+    syscall(__NR_futex,(jint*)address,FUTEX_WAKE,INT_MAX,0,0,0);
+#endif
+}
+
+static jlong GetMonotonicMillis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return jlong(now.tv_sec)*1000+now.tv_nsec/1000000;
+}
+
+///////////////////////////////////////////////// native methods
+
+/* Loads and stores are surrounded by full barriers: they order data
+ *  accesses like acquire / release do, and also separate positions
+ *  from waiting flags.
+ */
+static jint JNICALL NativeLoad(JNIEnv* env,jclass,jobject buffer,jint offset) {
+    jbyte* header=static_cast<jbyte*>(env->GetDirectBufferAddress(buffer));
+    if (!header) {
+        return 0;
+    }
+    __sync_synchronize();
+    jint value=*reinterpret_cast<volatile jint*>(header+offset);
+    __sync_synchronize();
+    return value;
+}
+
+static void JNICALL NativeStore(JNIEnv* env,jclass,jobject buffer,jint offset,jint value) {
+    jbyte* header=static_cast<jbyte*>(env->GetDirectBufferAddress(buffer));
+    if (header) {
+        __sync_synchronize();
+        *reinterpret_cast<volatile jint*>(header+offset)=value;
+        __sync_synchronize();
+    }
+}
+
+static void JNICALL NativeWait(JNIEnv* env,jclass,jobject buffer,jint offset,jint expected,jlong timeoutMillis) {
+    jbyte* header=static_cast<jbyte*>(env->GetDirectBufferAddress(buffer));
+    if (header) {
+        FutexWait(reinterpret_cast<volatile jint*>(header+offset),expected,timeoutMillis);
+    }
+}
+
+static void JNICALL NativeWake(JNIEnv* env,jclass,jobject buffer,jint offset) {
+    jbyte* header=static_cast<jbyte*>(env->GetDirectBufferAddress(buffer));
+    if (header) {
+        FutexWake(reinterpret_cast<volatile jint*>(header+offset));
+    }
+}
+
+void RingBuffer::RegisterNatives() {
+    static const JNINativeMethod methods[]={
+        {(char*)"nativeLoad",(char*)"(Ljava/nio/ByteBuffer;I)I",(void*)&NativeLoad},
+        {(char*)"nativeStore",(char*)"(Ljava/nio/ByteBuffer;II)V",(void*)&NativeStore},
+        {(char*)"nativeWait",(char*)"(Ljava/nio/ByteBuffer;IIJ)V",(void*)&NativeWait},
+        {(char*)"nativeWake",(char*)"(Ljava/nio/ByteBuffer;I)V",(void*)&NativeWake}
+    };
+    jni::LObject clazz=jni::FindClass("com/itoa/jnipp/RingBuffer");
+    jint error=jni::GetEnv()->RegisterNatives(
+        (jclass)clazz.GetJObject(),
+        methods,sizeof(methods)/sizeof(*methods));
+    jni::TranslateJavaException();
+    if (error) {
+        jni::FatalError("Error registering RingBuffer natives (%d).",error);
+    }
+}
+
+///////////////////////////////////////////////// implementation
+
+RingBuffer::RingBuffer(jint capacity):
+    m_header(0),
+    m_data(0),
+    m_capacity(0)
+{
+    if (capacity<=0 || (capacity & (capacity-1))) {
+        jni::FatalError("RingBuffer capacity (%d) must be a power of two.",capacity);
+    }
+    PByteBuffer buffer=ByteBuffer::AllocateDirect(HeaderSize+capacity);
+    jbyte* header=buffer->GetData();
+    memset(header,0,HeaderSize);
+    *reinterpret_cast<jint*>(header+CapacityOffset)=capacity;
+    Attach(buffer);
+}
+
+RingBuffer::RingBuffer(PByteBuffer buffer):
+    m_header(0),
+    m_data(0),
+    m_capacity(0)
+{
+    Attach(buffer);
+}
+
+void RingBuffer::Attach(PByteBuffer buffer) {
+    jbyte* header=buffer ? buffer->GetData() : 0;
+    if (!header) {
+        jni::FatalError("RingBuffer requires direct buffer.");
+    }
+    jlong length=buffer->GetLength();
+    jint capacity=*reinterpret_cast<jint*>(header+CapacityOffset);
+    if (length<HeaderSize || capacity<=0 ||
+        (capacity & (capacity-1)) || capacity>length-HeaderSize)
+    {
+        jni::FatalError("Buffer doesn't contain valid RingBuffer.");
+    }
+    m_buffer=buffer;
+    m_header=header;
+    m_data=header+HeaderSize;
+    m_capacity=size_t(capacity);
+}
+
+volatile jint* RingBuffer::GetHeaderInt(jint offset) const {
+    return reinterpret_cast<volatile jint*>(m_header+offset);
+}
+
+/* Positions owned by the other side are loaded with barrier after
+ *  the load, so data is read only after position that published it.
+ * Own positions are stored with barrier before the store, so data
+ *  is written before position that publishes it.
+ */
+
+size_t RingBuffer::GetReadableLength() const {
+    uint32_t writePosition=*GetHeaderInt(WritePositionOffset);
+    __sync_synchronize();
+    uint32_t readPosition=*GetHeaderInt(ReadPositionOffset);
+    return size_t(writePosition-readPosition);
+}
+
+size_t RingBuffer::GetWritableLength() const {
+    uint32_t readPosition=*GetHeaderInt(ReadPositionOffset);
+    __sync_synchronize();
+    uint32_t writePosition=*GetHeaderInt(WritePositionOffset);
+    return m_capacity-size_t(writePosition-readPosition);
+}
+
+size_t RingBuffer::Write(const void* data,size_t length) {
+    size_t writable=GetWritableLength();
+    if (length>writable) {
+        length=writable;
+    }
+    if (!length) {
+        return 0;
+    }
+    uint32_t writePosition=*GetHeaderInt(WritePositionOffset);
+    size_t offset=writePosition & (m_capacity-1);
+    size_t head=m_capacity-offset;
+    if (head>length) {
+        head=length;
+    }
+    memcpy(m_data+offset,data,head);
+    memcpy(m_data,static_cast<const jbyte*>(data)+head,length-head);
+
+    __sync_synchronize();
+    *GetHeaderInt(WritePositionOffset)=jint(writePosition+uint32_t(length));
+    __sync_synchronize();
+    if (*GetHeaderInt(ReaderWaitingOffset)) {
+        FutexWake(GetHeaderInt(WritePositionOffset));
+    }
+    return length;
+}
+
+size_t RingBuffer::Read(void* data,size_t length) {
+    size_t readable=GetReadableLength();
+    if (length>readable) {
+        length=readable;
+    }
+    if (!length) {
+        return 0;
+    }
+    uint32_t readPosition=*GetHeaderInt(ReadPositionOffset);
+    size_t offset=readPosition & (m_capacity-1);
+    size_t head=m_capacity-offset;
+    if (head>length) {
+        head=length;
+    }
+    memcpy(data,m_data+offset,head);
+    memcpy(static_cast<jbyte*>(data)+head,m_data,length-head);
+
+    __sync_synchronize();
+    *GetHeaderInt(ReadPositionOffset)=jint(readPosition+uint32_t(length));
+    __sync_synchronize();
+    if (*GetHeaderInt(WriterWaitingOffset)) {
+        FutexWake(GetHeaderInt(ReadPositionOffset));
+    }
+    return length;
+}
+
+bool RingBuffer::WaitReadable(jlong timeoutMillis) {
+    return Wait(true,timeoutMillis);
+}
+
+bool RingBuffer::WaitWritable(jlong timeoutMillis) {
+    return Wait(false,timeoutMillis);
+}
+
+/* Waiter raises its flag and then rechecks position, the other side
+ *  moves position and then checks the flag. Barriers between these
+ *  steps guarantee that either waiter sees new position or the other
+ *  side sees the flag and wakes it. Futex itself rechecks position
+ *  before blocking.
+ */
+bool RingBuffer::Wait(bool forReading,jlong timeoutMillis) {
+    volatile jint* position=GetHeaderInt(forReading ? WritePositionOffset : ReadPositionOffset);
+    volatile jint* waiting=GetHeaderInt(forReading ? ReaderWaitingOffset : WriterWaitingOffset);
+    jlong deadline=(timeoutMillis>0) ? GetMonotonicMillis()+timeoutMillis : 0;
+    for (;;) {
+        if (forReading ? GetReadableLength() : GetWritableLength()) {
+            return true;
+        }
+        jlong remaining=timeoutMillis;
+        if (timeoutMillis>0) {
+            remaining=deadline-GetMonotonicMillis();
+            if (remaining<0) {
+                remaining=0;
+            }
+        }
+        if (!remaining) {
+            return false;
+        }
+        *waiting=1;
+        __sync_synchronize();
+        jint observed=*position;
+        if (!(forReading ? GetReadableLength() : GetWritableLength())) {
+            FutexWait(position,observed,remaining);
+        }
+        *waiting=0;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(nio)
+END_NAMESPACE(java)
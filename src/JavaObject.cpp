@@ -15,6 +15,8 @@
  */
 
 #include "JNIpp.h"
+#include "WeakReference.h"
+#include <stdint.h>
 
 // TODO Convert all FatalError()s to std::exceptions.
 
@@ -26,17 +28,6 @@ BEGIN_NAMESPACE(java)
 
 ///////////////////////////////////////////////// WeakReference
 
-// Creates weak reference for the object.
-static jobject CreateWeakReference(jobject object);
-
-// Gets object from the weak reference, adds global
-//  reference to it.
-static jobject DerefWeakReference(jobject weakReference);
-
-// Destroys weak reference.
-static void DestroyWeakReference(jobject weakReference);
-
-
 #ifdef JNIPP_EMULATE_WEAK_GLOBAL_REFERENCES
 
 /* Implementation of the WeakReference functions using
@@ -70,7 +61,7 @@ static jobject LocalToGlobalRef(jobject object) {
     return globalObject;
 }
 
-static jobject CreateWeakReference(jobject object) {
+jobject CreateWeakReference(jobject object) {
     jobject weakReference=jni::GetEnv()->NewObject(
         (jclass)JB_GET_CLASS()->GetJObject(),
         JB_GET_METHOD_ID(Constructor),
@@ -79,14 +70,14 @@ static jobject CreateWeakReference(jobject object) {
     return LocalToGlobalRef(weakReference);
 }
 
-static jobject DerefWeakReference(jobject weakReference) {
+jobject DerefWeakReference(jobject weakReference) {
     jobject object=jni::GetEnv()->CallObjectMethod(
         weakReference,
         JB_GET_METHOD_ID(Get));
     return LocalToGlobalRef(object);
 }
 
-static void DestroyWeakReference(jobject weakReference) {
+void DestroyWeakReference(jobject weakReference) {
     jni::GetEnv()->DeleteGlobalRef(weakReference);
 }
 
@@ -98,20 +89,153 @@ static void DestroyWeakReference(jobject weakReference) {
  *  JNI's weak global references.
  */
 
-static jobject CreateWeakReference(jobject object) {
+jobject CreateWeakReference(jobject object) {
     return jni::GetEnv()->NewWeakGlobalRef(object);
 }
 
-static jobject DerefWeakReference(jobject weakReference) {
+jobject DerefWeakReference(jobject weakReference) {
     return jni::GetEnv()->NewGlobalRef(weakReference);
 }
 
-static void DestroyWeakReference(jobject weakReference) {
+void DestroyWeakReference(jobject weakReference) {
     jni::GetEnv()->DeleteWeakGlobalRef((jweak)weakReference);
 }
 
 #endif // JNIPP_EMULATE_WEAK_GLOBAL_REFERENCES
 
+///////////////////////////////////////////////// InstanceHandle
+
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+
+/* Instance handles: slot index in the low 32 bits and slot
+ *  generation in the high 32 bits. Generation is never 0 (so
+ *  handles are never 0) and is bumped every time slot is freed,
+ *  so stale handles don't match their slots anymore.
+ *
+ * Slots live in pages that are never moved or freed, which lets
+ *  ResolveInstanceHandle() run without a lock. Writers are
+ *  serialized by g_handlesLock and publish changes with barriers.
+ */
+
+static const uint32_t HandlePageSize=1024;
+static const uint32_t MaxHandlePages=4096;
+static const uint32_t NoFreeHandleSlot=uint32_t(-1);
+
+struct HandleSlot {
+    volatile uint32_t generation;
+    Object* volatile object;
+    uint32_t nextFree;
+};
+
+static HandleSlot* volatile g_handlePages[MaxHandlePages];
+static pthread_mutex_t g_handlesLock=PTHREAD_MUTEX_INITIALIZER;
+static uint32_t g_handleSlotCount=0;
+static uint32_t g_firstFreeHandleSlot=NoFreeHandleSlot;
+
+static HandleSlot* GetHandleSlot(uint32_t index) {
+    if (index>=HandlePageSize*MaxHandlePages) {
+        return 0;
+    }
+    HandleSlot* page=g_handlePages[index/HandlePageSize];
+    return page ? (page+index%HandlePageSize) : 0;
+}
+
+/* Must be called with g_handlesLock held.
+ */
+static uint32_t AllocateHandleSlot() {
+    if (g_firstFreeHandleSlot!=NoFreeHandleSlot) {
+        uint32_t index=g_firstFreeHandleSlot;
+        g_firstFreeHandleSlot=GetHandleSlot(index)->nextFree;
+        return index;
+    }
+    uint32_t index=g_handleSlotCount;
+    if (index==HandlePageSize*MaxHandlePages) {
+        pthread_mutex_unlock(&g_handlesLock);
+        jni::FatalError("Out of live instance handles (%u).",index);
+    }
+    if (!(index%HandlePageSize)) {
+        HandleSlot* page=new HandleSlot[HandlePageSize];
+        for (uint32_t i=0;i!=HandlePageSize;++i) {
+            page[i].generation=1;
+            page[i].object=0;
+            page[i].nextFree=NoFreeHandleSlot;
+        }
+        __sync_synchronize();
+        g_handlePages[index/HandlePageSize]=page;
+    }
+    g_handleSlotCount++;
+    return index;
+}
+
+uint32_t NextInstanceHandleGeneration(uint32_t generation) {
+    generation++;
+    return generation ? generation : 1;
+}
+
+jlong CreateInstanceHandle(Object* object) {
+    pthread_mutex_lock(&g_handlesLock);
+    uint32_t index=AllocateHandleSlot();
+    HandleSlot* slot=GetHandleSlot(index);
+    slot->object=object;
+    __sync_synchronize();
+    uint64_t handle=(uint64_t(slot->generation)<<32) | index;
+    pthread_mutex_unlock(&g_handlesLock);
+    return jlong(handle);
+}
+
+void DestroyInstanceHandle(jlong handle) {
+    uint32_t index=uint32_t(uint64_t(handle));
+    uint32_t generation=uint32_t(uint64_t(handle)>>32);
+    pthread_mutex_lock(&g_handlesLock);
+    HandleSlot* slot=GetHandleSlot(index);
+    if (slot && slot->generation==generation) {
+        slot->object=0;
+        __sync_synchronize();
+        slot->generation=NextInstanceHandleGeneration(generation);
+        slot->nextFree=g_firstFreeHandleSlot;
+        g_firstFreeHandleSlot=index;
+    }
+    pthread_mutex_unlock(&g_handlesLock);
+}
+
+/* Generation is checked again after the object is read: slot can
+ *  be freed and reused in between, but its generation is bumped
+ *  before that happens.
+ */
+Object* ResolveInstanceHandle(jlong handle) {
+    uint32_t index=uint32_t(uint64_t(handle));
+    uint32_t generation=uint32_t(uint64_t(handle)>>32);
+    HandleSlot* slot=GetHandleSlot(index);
+    if (!slot || slot->generation!=generation) {
+        return 0;
+    }
+    Object* object=slot->object;
+    __sync_synchronize();
+    return (slot->generation==generation) ? object : 0;
+}
+
+#endif // JNIPP_NATIVE_INSTANCE_HANDLES
+
+///////////////////////////////////////////////// instance field
+
+static void SetInstanceData(jobject object,jfieldID instanceFieldID,jlong data) {
+#ifdef JNIPP_NATIVE_INSTANCE_LONG
+    jni::GetEnv()->SetLongField(object,instanceFieldID,data);
+#else
+    // Instance pointers must fit into 'int' fields.
+    (void)sizeof(char[(sizeof(void*)<=sizeof(jint)) ? 1 : -1]);
+    jni::GetEnv()->SetIntField(object,instanceFieldID,jint(data));
+#endif
+}
+
+static jlong GetInstanceData(jobject object,jfieldID instanceFieldID) {
+#ifdef JNIPP_NATIVE_INSTANCE_LONG
+    return jni::GetEnv()->GetLongField(object,instanceFieldID);
+#else
+    return jni::GetEnv()->GetIntField(object,instanceFieldID);
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////// Object
 
 #define JB_CURRENT_CLASS Object
@@ -165,6 +289,9 @@ void Object::Construct(const jni::LObject& object,jfieldID instanceFieldID) {
     m_weakReference=0;
     m_referenceCount=0;
     m_instanceFieldID=instanceFieldID;
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+    m_instanceHandle=0;
+#endif
     if (!object) {
         jni::FatalError("Can't create java::Object with null object.");
     }
@@ -177,7 +304,12 @@ void Object::Construct(const jni::LObject& object,jfieldID instanceFieldID) {
                   this,
                   object.GetJObject(),
                   m_weakReference);
-        jni::SetIntField(object,m_instanceFieldID,(jint)this);
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+        m_instanceHandle=CreateInstanceHandle(this);
+        SetInstanceData(object.GetJObject(),m_instanceFieldID,m_instanceHandle);
+#else
+        SetInstanceData(object.GetJObject(),m_instanceFieldID,(jlong)(intptr_t)this);
+#endif
         m_referenceCount++;
     }
 }
@@ -211,10 +343,13 @@ Object::~Object() {
         //  Release() reference causing second object destruction.
         jobject object=DerefWeakReference(m_weakReference);
         if (object) {
-            jni::GetEnv()->SetIntField(object,m_instanceFieldID,0);
+            SetInstanceData(object,m_instanceFieldID,0);
             jni::GetEnv()->DeleteGlobalRef(object);
         }
         DestroyWeakReference(m_weakReference);
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+        DestroyInstanceHandle(m_instanceHandle);
+#endif
     }
 }
 
@@ -264,8 +399,12 @@ void Object::Release() const {
 }
 
 Object* Object::GetLiveInstance(jobject object,jfieldID instanceFieldID) {
-    int instanceData=jni::GetEnv()->GetIntField(object,instanceFieldID);
-    return (Object*)instanceData;
+    jlong instanceData=GetInstanceData(object,instanceFieldID);
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+    return instanceData ? ResolveInstanceHandle(instanceData) : 0;
+#else
+    return (Object*)(intptr_t)instanceData;
+#endif
 }
 
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JNIpp.h"
+
+#if defined(__SSSE3__)
+#   include <tmmintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+#if !defined(__SSE2__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#   include <arm_neon.h>
+#   define JNIPP_PACKED_NEON
+#endif
+
+/* Vector loops below swap whole 16-byte blocks, the rest is swapped
+ *  by scalar loops. Each block is loaded before it's stored, so
+ *  in-place swapping works.
+ */
+
+BEGIN_NAMESPACE(java)
+
+///////////////////////////////////////////////////////////////////// helpers
+
+template <size_t Size>
+static void SwapTail(const uint8_t* in,size_t count,uint8_t* out) {
+    typedef PackedBits<Size> Bits;
+    for (size_t i=0;i!=count;++i) {
+        typename Bits::Type value;
+        memcpy(&value,in+i*Size,Size);
+        value=Bits::Swap(value);
+        memcpy(out+i*Size,&value,Size);
+    }
+}
+
+#if defined(__SSE2__) && !defined(__SSSE3__)
+
+/* Swaps bytes within each 16-bit word. */
+static inline __m128i SwapWordBytes(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////// swaps
+
+static void SwapBytes16(const uint8_t* in,size_t count,uint8_t* out) {
+    size_t i=0;
+#if defined(__SSSE3__)
+    const __m128i mask=_mm_set_epi8(14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1);
+    for (;i+8<=count;i+=8) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*2));
+        _mm_storeu_si128((__m128i*)(out+i*2),_mm_shuffle_epi8(v,mask));
+    }
+#elif defined(__SSE2__)
+    for (;i+8<=count;i+=8) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*2));
+        _mm_storeu_si128((__m128i*)(out+i*2),SwapWordBytes(v));
+    }
+#elif defined(JNIPP_PACKED_NEON)
+    for (;i+8<=count;i+=8) {
+        vst1q_u8(out+i*2,vrev16q_u8(vld1q_u8(in+i*2)));
+    }
+#endif
+    SwapTail<2>(in+i*2,count-i,out+i*2);
+}
+
+static void SwapBytes32(const uint8_t* in,size_t count,uint8_t* out) {
+    size_t i=0;
+#if defined(__SSSE3__)
+    const __m128i mask=_mm_set_epi8(12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3);
+    for (;i+4<=count;i+=4) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*4));
+        _mm_storeu_si128((__m128i*)(out+i*4),_mm_shuffle_epi8(v,mask));
+    }
+#elif defined(__SSE2__)
+    for (;i+4<=count;i+=4) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*4));
+        // Swap words within dwords, then bytes within words.
+        v=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v,0xB1),0xB1);
+        _mm_storeu_si128((__m128i*)(out+i*4),SwapWordBytes(v));
+    }
+#elif defined(JNIPP_PACKED_NEON)
+    for (;i+4<=count;i+=4) {
+        vst1q_u8(out+i*4,vrev32q_u8(vld1q_u8(in+i*4)));
+    }
+#endif
+    SwapTail<4>(in+i*4,count-i,out+i*4);
+}
+
+static void SwapBytes64(const uint8_t* in,size_t count,uint8_t* out) {
+    size_t i=0;
+#if defined(__SSSE3__)
+    const __m128i mask=_mm_set_epi8(8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7);
+    for (;i+2<=count;i+=2) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*8));
+        _mm_storeu_si128((__m128i*)(out+i*8),_mm_shuffle_epi8(v,mask));
+    }
+#elif defined(__SSE2__)
+    for (;i+2<=count;i+=2) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i*8));
+        // Reverse words within qwords, then bytes within words.
+        v=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v,0x1B),0x1B);
+        _mm_storeu_si128((__m128i*)(out+i*8),SwapWordBytes(v));
+    }
+#elif defined(JNIPP_PACKED_NEON)
+    for (;i+2<=count;i+=2) {
+        vst1q_u8(out+i*8,vrev64q_u8(vld1q_u8(in+i*8)));
+    }
+#endif
+    SwapTail<8>(in+i*8,count-i,out+i*8);
+}
+
+void SwapBytes(const void* in,size_t count,size_t elementSize,void* out) {
+    const uint8_t* input=static_cast<const uint8_t*>(in);
+    uint8_t* output=static_cast<uint8_t*>(out);
+    switch (elementSize) {
+        case 1:
+            if (in!=out) {
+                memcpy(out,in,count);
+            }
+            break;
+        case 2:
+            SwapBytes16(input,count,output);
+            break;
+        case 4:
+            SwapBytes32(input,count,output);
+            break;
+        case 8:
+            SwapBytes64(input,count,output);
+            break;
+        default:
+            jni::FatalError("SwapBytes: unsupported element size %d.",int(elementSize));
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+
+END_NAMESPACE(java)
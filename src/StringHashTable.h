@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _STRINGHASHTABLE_INCLUDED_
+#define _STRINGHASHTABLE_INCLUDED_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <dropins/begin_namespace.h>
+
+///////////////////////////////////////////////////////////////////// StringHashTable
+
+BEGIN_NAMESPACE(jb)
+
+/* Chained hash table keyed by strings; names are hashed with FNV-1a.
+ * Table is not synchronized, callers are expected to guard it
+ *  (usually with read-write lock, as lookups outnumber inserts).
+ * V must be default-constructible and copyable.
+ *
+ * Used by the native factory registry (see JavaBinding.cpp) and by
+ *  android samples.
+ */
+template <class V>
+class StringHashTable {
+public:
+    StringHashTable():
+        m_count(0)
+    {
+    }
+
+    ~StringHashTable() {
+        Clear();
+    }
+
+    /* Returns value for 'name', or 0 if there is no such value. */
+    V* Find(const char* name) const {
+        Entry* entry=FindEntry(name,Hash(name));
+        return entry ? &entry->value : 0;
+    }
+
+    /* Returns value for 'name', adding default-constructed value
+     *  if there is no such value.
+     */
+    V& Insert(const char* name) {
+        uint32_t hash=Hash(name);
+        Entry* entry=FindEntry(name,hash);
+        if (!entry) {
+            if (m_count>=m_buckets.size()) {
+                Rehash(m_buckets.empty() ? size_t(MinBucketCount) : m_buckets.size()*2);
+            }
+            entry=new Entry();
+            entry->hash=hash;
+            entry->name=name;
+            Entry*& bucket=m_buckets[hash & (m_buckets.size()-1)];
+            entry->next=bucket;
+            bucket=entry;
+            m_count++;
+        }
+        return entry->value;
+    }
+
+    void Clear() {
+        for (size_t i=0;i!=m_buckets.size();++i) {
+            Entry* entry=m_buckets[i];
+            while (entry) {
+                Entry* next=entry->next;
+                delete entry;
+                entry=next;
+            }
+        }
+        m_buckets.clear();
+        m_count=0;
+    }
+
+    size_t GetCount() const {
+        return m_count;
+    }
+
+    /* FNV-1a. */
+    static uint32_t Hash(const char* name) {
+        uint32_t hash=2166136261u;
+        for (;*name;++name) {
+            hash=(hash ^ uint8_t(*name))*16777619u;
+        }
+        return hash;
+    }
+
+private:
+    StringHashTable(const StringHashTable&);
+    StringHashTable& operator=(const StringHashTable&);
+
+    struct Entry {
+        Entry(): next(0),hash(0),value() {}
+        Entry* next;
+        uint32_t hash;
+        V value;
+        std::string name;
+    };
+
+    /* Must be a power of 2. */
+    enum { MinBucketCount=32 };
+
+    Entry* FindEntry(const char* name,uint32_t hash) const {
+        if (m_buckets.empty()) {
+            return 0;
+        }
+        Entry* entry=m_buckets[hash & (m_buckets.size()-1)];
+        for (;entry;entry=entry->next) {
+            if (entry->hash==hash && entry->name==name) {
+                break;
+            }
+        }
+        return entry;
+    }
+
+    void Rehash(size_t bucketCount) {
+        std::vector<Entry*> buckets(bucketCount,(Entry*)0);
+        for (size_t i=0;i!=m_buckets.size();++i) {
+            Entry* entry=m_buckets[i];
+            while (entry) {
+                Entry* next=entry->next;
+                Entry*& bucket=buckets[entry->hash & (bucketCount-1)];
+                entry->next=bucket;
+                bucket=entry;
+                entry=next;
+            }
+        }
+        m_buckets.swap(buckets);
+    }
+
+private:
+    std::vector<Entry*> m_buckets;
+    size_t m_count;
+};
+
+END_NAMESPACE(jb)
+
+/////////////////////////////////////////////////////////////////////
+
+#endif // _STRINGHASHTABLE_INCLUDED_
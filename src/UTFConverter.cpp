@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UTFConverter.h"
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+#if !defined(__SSE2__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#   include <arm_neon.h>
+#   define JNIPP_UTF_NEON
+#endif
+
+///////////////////////////////////////////////////////////////////// helpers
+
+static const jchar ReplacementCharacter=0xFFFD;
+
+static inline bool IsHighSurrogate(jchar c) {
+    return (c & 0xFC00)==0xD800;
+}
+
+static inline bool IsLowSurrogate(jchar c) {
+    return (c & 0xFC00)==0xDC00;
+}
+
+///////////////////////////////////////////////// ASCII runs
+
+/* Functions below process leading run of ASCII characters and return
+ *  its length. Vector loops handle whole blocks, scalar loop handles
+ *  the rest of the run.
+ */
+
+static size_t WidenASCII(const uint8_t* in,size_t length,jchar* out) {
+    size_t i=0;
+#if defined(__AVX2__)
+    for (;i+32<=length;i+=32) {
+        __m256i v=_mm256_loadu_si256((const __m256i*)(in+i));
+        if (_mm256_movemask_epi8(v)) {
+            break;
+        }
+        _mm256_storeu_si256((__m256i*)(out+i),
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256((__m256i*)(out+i+16),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v,1)));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i zero=_mm_setzero_si128();
+    for (;i+16<=length;i+=16) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(in+i));
+        if (_mm_movemask_epi8(v)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i*)(out+i),_mm_unpacklo_epi8(v,zero));
+        _mm_storeu_si128((__m128i*)(out+i+8),_mm_unpackhi_epi8(v,zero));
+    }
+#elif defined(JNIPP_UTF_NEON)
+    for (;i+16<=length;i+=16) {
+        uint8x16_t v=vld1q_u8(in+i);
+        uint8x8_t high=vand_u8(
+            vorr_u8(vget_low_u8(v),vget_high_u8(v)),
+            vdup_n_u8(0x80));
+        if (vget_lane_u64(vreinterpret_u64_u8(high),0)) {
+            break;
+        }
+        vst1q_u16(out+i,vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(out+i+8,vmovl_u8(vget_high_u8(v)));
+    }
+#endif
+    for (;i!=length && in[i]<0x80;++i) {
+        out[i]=in[i];
+    }
+    return i;
+}
+
+static size_t NarrowASCII(const jchar* in,size_t length,uint8_t* out) {
+    size_t i=0;
+#if defined(__AVX2__)
+    const __m256i mask256=_mm256_set1_epi16((short)0xFF80);
+    for (;i+32<=length;i+=32) {
+        __m256i a=_mm256_loadu_si256((const __m256i*)(in+i));
+        __m256i b=_mm256_loadu_si256((const __m256i*)(in+i+16));
+        if (!_mm256_testz_si256(_mm256_or_si256(a,b),mask256)) {
+            break;
+        }
+        // packus works within 128-bit lanes, fix the order.
+        __m256i packed=_mm256_permute4x64_epi64(_mm256_packus_epi16(a,b),0xD8);
+        _mm256_storeu_si256((__m256i*)(out+i),packed);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i mask=_mm_set1_epi16((short)0xFF80);
+    const __m128i zero=_mm_setzero_si128();
+    for (;i+16<=length;i+=16) {
+        __m128i a=_mm_loadu_si128((const __m128i*)(in+i));
+        __m128i b=_mm_loadu_si128((const __m128i*)(in+i+8));
+        __m128i high=_mm_and_si128(_mm_or_si128(a,b),mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high,zero))!=0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128((__m128i*)(out+i),_mm_packus_epi16(a,b));
+    }
+#elif defined(JNIPP_UTF_NEON)
+    const uint16x8_t mask=vdupq_n_u16(0xFF80);
+    for (;i+16<=length;i+=16) {
+        uint16x8_t a=vld1q_u16(in+i);
+        uint16x8_t b=vld1q_u16(in+i+8);
+        uint16x8_t high=vandq_u16(vorrq_u16(a,b),mask);
+        uint16x4_t high4=vorr_u16(vget_low_u16(high),vget_high_u16(high));
+        if (vget_lane_u64(vreinterpret_u64_u16(high4),0)) {
+            break;
+        }
+        vst1q_u8(out+i,vcombine_u8(vmovn_u16(a),vmovn_u16(b)));
+    }
+#endif
+    for (;i!=length && in[i]<0x80;++i) {
+        out[i]=uint8_t(in[i]);
+    }
+    return i;
+}
+
+static size_t SkipASCII(const jchar* in,size_t length) {
+    size_t i=0;
+#if defined(__SSE2__)
+    const __m128i mask=_mm_set1_epi16((short)0xFF80);
+    const __m128i zero=_mm_setzero_si128();
+    for (;i+16<=length;i+=16) {
+        __m128i a=_mm_loadu_si128((const __m128i*)(in+i));
+        __m128i b=_mm_loadu_si128((const __m128i*)(in+i+8));
+        __m128i high=_mm_and_si128(_mm_or_si128(a,b),mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high,zero))!=0xFFFF) {
+            break;
+        }
+    }
+#elif defined(JNIPP_UTF_NEON)
+    const uint16x8_t mask=vdupq_n_u16(0xFF80);
+    for (;i+16<=length;i+=16) {
+        uint16x8_t high=vandq_u16(vorrq_u16(vld1q_u16(in+i),vld1q_u16(in+i+8)),mask);
+        uint16x4_t high4=vorr_u16(vget_low_u16(high),vget_high_u16(high));
+        if (vget_lane_u64(vreinterpret_u64_u16(high4),0)) {
+            break;
+        }
+    }
+#endif
+    for (;i!=length && in[i]<0x80;++i) {
+    }
+    return i;
+}
+
+///////////////////////////////////////////////////////////////////// UTF-8 -> UTF-16
+
+/* Decodes one non-ASCII sequence. On success stores code point and
+ *  returns sequence length. On failure returns length of the maximal
+ *  invalid subpart (at least 1) and stores ReplacementCharacter.
+ */
+static size_t DecodeUTF8(const uint8_t* in,size_t length,uint32_t& codePoint) {
+    uint8_t lead=in[0];
+    size_t sequenceLength=0;
+    uint8_t lower=0x80;
+    uint8_t upper=0xBF;
+    if (lead>=0xC2 && lead<=0xDF) {
+        sequenceLength=2;
+        codePoint=lead & 0x1F;
+    } else if (lead>=0xE0 && lead<=0xEF) {
+        sequenceLength=3;
+        codePoint=lead & 0x0F;
+        if (lead==0xE0) {
+            lower=0xA0;
+        } else if (lead==0xED) {
+            // Exclude surrogates.
+            upper=0x9F;
+        }
+    } else if (lead>=0xF0 && lead<=0xF4) {
+        sequenceLength=4;
+        codePoint=lead & 0x07;
+        if (lead==0xF0) {
+            lower=0x90;
+        } else if (lead==0xF4) {
+            upper=0x8F;
+        }
+    } else {
+        codePoint=ReplacementCharacter;
+        return 1;
+    }
+    for (size_t i=1;i!=sequenceLength;++i) {
+        if (i==length || in[i]<lower || in[i]>upper) {
+            codePoint=ReplacementCharacter;
+            return i;
+        }
+        codePoint=(codePoint<<6) | (in[i] & 0x3F);
+        lower=0x80;
+        upper=0xBF;
+    }
+    return sequenceLength;
+}
+
+size_t ConvertUTF8ToUTF16(const char* utf8,size_t length,jchar* utf16) {
+    const uint8_t* in=(const uint8_t*)utf8;
+    const uint8_t* end=in+length;
+    jchar* out=utf16;
+    while (in!=end) {
+        if (*in<0x80) {
+            size_t count=WidenASCII(in,size_t(end-in),out);
+            in+=count;
+            out+=count;
+            continue;
+        }
+        uint32_t codePoint=0;
+        in+=DecodeUTF8(in,size_t(end-in),codePoint);
+        if (codePoint<0x10000) {
+            *out++=jchar(codePoint);
+        } else {
+            codePoint-=0x10000;
+            *out++=jchar(0xD800+(codePoint>>10));
+            *out++=jchar(0xDC00+(codePoint & 0x3FF));
+        }
+    }
+    return size_t(out-utf16);
+}
+
+///////////////////////////////////////////////////////////////////// UTF-16 -> UTF-8
+
+size_t GetUTF8Length(const jchar* utf16,size_t length) {
+    size_t utf8Length=0;
+    size_t i=0;
+    while (i!=length) {
+        jchar c=utf16[i];
+        if (c<0x80) {
+            size_t count=SkipASCII(utf16+i,length-i);
+            utf8Length+=count;
+            i+=count;
+            continue;
+        }
+        if (c<0x800) {
+            utf8Length+=2;
+        } else if (IsHighSurrogate(c) && i+1!=length && IsLowSurrogate(utf16[i+1])) {
+            utf8Length+=4;
+            ++i;
+        } else {
+            // BMP character or U+FFFD for unpaired surrogate.
+            utf8Length+=3;
+        }
+        ++i;
+    }
+    return utf8Length;
+}
+
+size_t ConvertUTF16ToUTF8(const jchar* utf16,size_t length,char* utf8) {
+    uint8_t* out=(uint8_t*)utf8;
+    size_t i=0;
+    while (i!=length) {
+        uint32_t c=utf16[i];
+        if (c<0x80) {
+            size_t count=NarrowASCII(utf16+i,length-i,out);
+            out+=count;
+            i+=count;
+            continue;
+        }
+        if (c<0x800) {
+            *out++=uint8_t(0xC0 | (c>>6));
+            *out++=uint8_t(0x80 | (c & 0x3F));
+        } else if (IsHighSurrogate(jchar(c)) && i+1!=length && IsLowSurrogate(utf16[i+1])) {
+            c=0x10000+((c-0xD800)<<10)+(utf16[i+1]-0xDC00);
+            *out++=uint8_t(0xF0 | (c>>18));
+            *out++=uint8_t(0x80 | ((c>>12) & 0x3F));
+            *out++=uint8_t(0x80 | ((c>>6) & 0x3F));
+            *out++=uint8_t(0x80 | (c & 0x3F));
+            ++i;
+        } else {
+            if (IsHighSurrogate(jchar(c)) || IsLowSurrogate(jchar(c))) {
+                c=ReplacementCharacter;
+            }
+            *out++=uint8_t(0xE0 | (c>>12));
+            *out++=uint8_t(0x80 | ((c>>6) & 0x3F));
+            *out++=uint8_t(0x80 | (c & 0x3F));
+        }
+        ++i;
+    }
+    return size_t(out-(uint8_t*)utf8);
+}
+
+/////////////////////////////////////////////////////////////////////
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UTFCONVERTER_INCLUDED_
+#define _UTFCONVERTER_INCLUDED_
+
+#include <stddef.h>
+#include <jni.h>
+
+///////////////////////////////////////////////////////////////////// UTF converter
+
+/* Converters between standard UTF-8 and UTF-16.
+ *
+ * Unlike JNI's modified UTF-8, standard UTF-8 encodes supplementary
+ *  characters as 4-byte sequences and NUL as a single zero byte.
+ *
+ * Malformed input (invalid UTF-8 sequences, unpaired surrogates) is
+ *  replaced with U+FFFD, so conversion never fails.
+ *
+ * Runs of ASCII characters are converted with SSE2/AVX2/NEON when
+ *  compiler targets them; everything else goes through scalar code.
+ */
+
+/* Maximum number of UTF-16 units produced from 'length' bytes of UTF-8.
+ */
+inline size_t GetMaxUTF16Length(size_t utf8Length) {
+    return utf8Length;
+}
+
+/* Converts UTF-8 to UTF-16, returns number of units written.
+ * 'utf16' must have room for GetMaxUTF16Length(length) units.
+ */
+size_t ConvertUTF8ToUTF16(const char* utf8,size_t length,jchar* utf16);
+
+/* Returns number of bytes UTF-16 string will take in UTF-8.
+ */
+size_t GetUTF8Length(const jchar* utf16,size_t length);
+
+/* Converts UTF-16 to UTF-8, returns number of bytes written.
+ * 'utf8' must have room for GetUTF8Length(utf16,length) bytes.
+ */
+size_t ConvertUTF16ToUTF8(const jchar* utf16,size_t length,char* utf8);
+
+/////////////////////////////////////////////////////////////////////
+
+#endif // _UTFCONVERTER_INCLUDED_
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _WEAKREFERENCE_INCLUDED_
+#define _WEAKREFERENCE_INCLUDED_
+
+#include "JNIpp.h"
+
+///////////////////////////////////////////////////////////////////// WeakReference
+
+/* Weak references, implemented either with JNI's weak global references
+ *  or (if JNIPP_EMULATE_WEAK_GLOBAL_REFERENCES is defined) with
+ *  java.lang.ref.WeakReference class. See JavaObject.cpp.
+ */
+
+BEGIN_NAMESPACE(java)
+
+// Creates weak reference for the object.
+jobject CreateWeakReference(jobject object);
+
+// Gets object from the weak reference, adds global
+//  reference to it. Returns NULL if object was collected.
+jobject DerefWeakReference(jobject weakReference);
+
+// Destroys weak reference.
+void DestroyWeakReference(jobject weakReference);
+
+END_NAMESPACE(java)
+
+/////////////////////////////////////////////////////////////////////
+
+#endif // _WEAKREFERENCE_INCLUDED_
@@ -37,4 +37,8 @@ public class Fields {
     public static long staticLongField;
     public static float staticFloatField;
     public static double staticDoubleField;
+
+    public static final int CONSTANT_INT = 0x7E57;
+    public static final boolean CONSTANT_BOOLEAN = true;
+    public static final String CONSTANT_STRING = "constant";
 }
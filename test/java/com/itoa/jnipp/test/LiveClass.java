@@ -102,5 +102,5 @@ public class LiveClass extends LiveClassBase {
 
     /* Bindings to native code. */
     protected native void finalize();
-    private int nativeInstance;
+    private long nativeInstance;
 }
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+#include <math.h>
+
+#define TEST_NAME "AlgorithmsTest"
+
+/////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Doubler {
+    jint operator()(jint value) const {
+        return value*2;
+    }
+};
+
+struct PlusOne {
+    jfloat operator()(jfloat value) const {
+        return value+1;
+    }
+};
+
+}
+
+void RunAlgorithmsTest() {
+    namespace algorithms=java::algorithms;
+
+    // Large enough to be split into several chunks.
+    const jsize length=100000;
+    java::PIntArray array=new java::IntArray(length);
+    {
+        java::IntArray::Elements elements(*array);
+        for (jsize i=0;i!=length;++i) {
+            elements[i]=length-i;
+        }
+    }
+
+    jlong sum=algorithms::Sum(*array);
+    TEST_CHECK_FAIL(sum!=jlong(length)*(length+1)/2,
+        "Sum: invalid result %lld.",(long long)sum);
+    TEST_CHECK_FAIL(algorithms::Min(*array)!=1,
+        "Min: invalid result %d.",algorithms::Min(*array));
+    TEST_CHECK_FAIL(algorithms::Max(*array)!=length,
+        "Max: invalid result %d.",algorithms::Max(*array));
+
+    algorithms::Sort(*array);
+    {
+        java::IntArray::Elements elements(*array);
+        for (jsize i=0;i!=length;++i) {
+            TEST_CHECK_FAIL(elements[i]!=i+1,
+                "Sort: invalid element %d at %d.",elements[i],i);
+        }
+        elements.Abort();
+    }
+    TEST_CHECK_FAIL(algorithms::BinarySearch(*array,jint(777))!=776,
+        "BinarySearch: invalid index.");
+    TEST_CHECK_FAIL(algorithms::BinarySearch(*array,jint(0))!=-1,
+        "BinarySearch: invalid insertion point.");
+
+    algorithms::Transform(*array,Doubler());
+    TEST_CHECK_FAIL(array->GetAt(9)!=20,
+        "Transform: invalid value %d.",array->GetAt(9));
+
+    java::PFloatArray ones=new java::FloatArray(length);
+    algorithms::Transform(*ones,PlusOne());
+    algorithms::PrefixSum(*ones);
+    TEST_CHECK_FAIL(ones->GetAt(length-1)!=jfloat(length),
+        "PrefixSum: invalid last value %f.",ones->GetAt(length-1));
+    TEST_CHECK_FAIL(algorithms::Dot(*ones,*ones)<1e14,
+        "Dot: invalid result.");
+
+    // Integer sums wrap around.
+    java::PIntArray large=new java::IntArray(3);
+    large->SetAt(0,0x7FFFFFFF);
+    large->SetAt(1,1);
+    large->SetAt(2,1);
+    algorithms::PrefixSum(*large);
+    TEST_CHECK_FAIL(large->GetAt(1)!=jint(0x80000000) || large->GetAt(2)!=jint(0x80000001),
+        "PrefixSum: integer sum didn't wrap around.");
+
+    // NaNs are sorted last and are returned by Min/Max wherever they are.
+    java::PFloatArray floats=new java::FloatArray(length);
+    {
+        java::FloatArray::Elements elements(*floats);
+        for (jsize i=0;i!=length;++i) {
+            elements[i]=jfloat(length-i);
+        }
+        elements[length/3]=NAN;
+        elements[length/2]=NAN;
+    }
+    jfloat minimum=algorithms::Min(*floats);
+    jfloat maximum=algorithms::Max(*floats);
+    TEST_CHECK_FAIL(minimum==minimum || maximum==maximum,
+        "Min/Max: NaN was not returned (%f, %f).",minimum,maximum);
+    algorithms::Sort(*floats);
+    {
+        java::FloatArray::Elements elements(*floats);
+        for (jsize i=1;i!=length-2;++i) {
+            TEST_CHECK_FAIL(!(elements[i-1]<=elements[i]),
+                "Sort: invalid float element %f at %d.",elements[i],i);
+        }
+        TEST_CHECK_FAIL(elements[length-2]==elements[length-2] ||
+                        elements[length-1]==elements[length-1],
+            "Sort: NaNs are not at the end.");
+        elements.Abort();
+    }
+    TEST_CHECK_FAIL(algorithms::BinarySearch(*floats,jfloat(777))!=776,
+        "BinarySearch: invalid float index.");
+    TEST_CHECK_FAIL(algorithms::BinarySearch(*floats,jfloat(NAN))<length-2,
+        "BinarySearch: NaN was not found.");
+    TEST_CHECK_FAIL(algorithms::BinarySearch(*floats,jfloat(0.5f))!=-1,
+        "BinarySearch: invalid float insertion point.");
+
+    TEST_PASSED();
+}
@@ -15,6 +15,8 @@
  */
 
 #include "Common.h"
+#include <algorithm>
+#include <numeric>
 
 #define TEST_NAME "ArrayTest"
 
@@ -90,5 +92,202 @@ void RunArrayTest() {
             "Invalid bits value: %08X (expected %08X).",value,expectedValue);
     }
 
+    {
+        const int length=100;
+        java::PIntArray array=new java::IntArray(length);
+        {
+            java::IntArray::Elements elements(*array);
+            TEST_CHECK_FAIL(elements.GetLength()!=length,
+                "Invalid elements length %d (expected %d).",
+                elements.GetLength(),length);
+            for (int i=0;i!=length;++i) {
+                elements[i]=i*3;
+            }
+        }
+        TEST_CHECK_FAIL(array->GetAt(length-1)!=(length-1)*3,
+            "Elements: changes are not committed.");
+
+        bool isCopy=false;
+        {
+            java::IntArray::Elements elements(*array);
+            isCopy=elements.IsCopy();
+            for (jint* i=elements.Begin();i!=elements.End();++i) {
+                *i=-1;
+            }
+            elements.Abort();
+            TEST_CHECK_FAIL(elements.GetData(),
+                "Elements: data is available after Abort().");
+        }
+        if (isCopy) {
+            TEST_CHECK_FAIL(array->GetAt(0)!=0,
+                "Elements: changes are committed after Abort().");
+        }
+    }
+
+    {
+        const int length=64;
+        java::PFloatArray input=new java::FloatArray(length);
+        java::PFloatArray output=new java::FloatArray(length);
+        {
+            java::FloatArray::Critical critical(*input);
+            for (int i=0;i!=length;++i) {
+                critical[i]=jfloat(i);
+            }
+        }
+        {
+            java::CriticalArrays arrays;
+            size_t in=arrays.Add(*input);
+            size_t out=arrays.Add(*output);
+            arrays.Pin();
+            const jfloat* inData=arrays.GetData<jfloat>(in);
+            jfloat* outData=arrays.GetData<jfloat>(out);
+            for (jsize i=0;i!=arrays.GetLength(in);++i) {
+                outData[i]=inData[i]*2;
+            }
+        }
+        TEST_CHECK_FAIL(output->GetAt(length-1)!=jfloat((length-1)*2),
+            "CriticalArrays: changes are not committed.");
+    }
+
+    {
+        // Several chunks.
+        const int length=5000;
+        java::PIntArray array=new java::IntArray(length);
+        {
+            java::IntArray::Window window(*array);
+            for (int i=0;i!=length;++i) {
+                window.begin()[i]=length-i;
+            }
+            std::sort(window.begin(),window.end());
+            jint sum=std::accumulate(window.begin(),window.end(),0);
+            TEST_CHECK_FAIL(sum!=length*(length+1)/2,
+                "Window: invalid sum %d.",sum);
+        }
+        for (int i=0;i!=length;i+=999) {
+            TEST_CHECK_FAIL(array->GetAt(i)!=i+1,
+                "Window: invalid value %d at %d (expected %d).",
+                array->GetAt(i),i,i+1);
+        }
+    }
+
+    {
+        const jsize length=200;
+        java::PStringArray array=new java::StringArray(length);
+        array->SetAt(length-1,java::PString::New("last"));
+
+        java::PString last;
+        jsize count=0;
+        java::StringArray::Reader reader(*array,16);
+        while (reader.Next()) {
+            TEST_CHECK_FAIL(reader.GetIndex()!=count,
+                "Reader: invalid index %d (expected %d).",reader.GetIndex(),count);
+            if (!reader.Get().IsEmpty()) {
+                last=reader.Keep();
+            }
+            ++count;
+        }
+        TEST_CHECK_FAIL(count!=length,
+            "Reader: read %d elements (expected %d).",count,length);
+        TEST_CHECK_FAIL(!last || strcmp(last->GetUTF(),"last"),
+            "Reader: invalid kept element.");
+    }
+
+    {
+        java::PrimitiveArrayPool<jfloat> pool(1);
+        java::PFloatArray first=pool.Checkout(16);
+        TEST_CHECK_FAIL(first->GetLength()!=16,
+            "Pool: invalid length %d.",first->GetLength());
+        pool.Return(first);
+        java::PFloatArray second=pool.Checkout(16);
+        TEST_CHECK_FAIL(second!=first,
+            "Pool: array was not reused.");
+        java::PFloatArray third=pool.Checkout(16);
+        TEST_CHECK_FAIL(third==second,
+            "Pool: array was handed out twice.");
+        pool.Return(second);
+        pool.Return(third);
+
+        java::PrimitiveArrayPool<jfloat>::Stats stats=pool.GetStats();
+        TEST_CHECK_FAIL(stats.hits!=1 || stats.misses!=2 || stats.drops!=1 || stats.pooled!=1,
+            "Pool: invalid stats (%d,%d,%d,%d).",
+            (int)stats.hits,(int)stats.misses,(int)stats.drops,(int)stats.pooled);
+    }
+
+    {
+        std::vector<double> values;
+        for (int i=0;i!=5000;++i) {
+            values.push_back(i*0.5);
+        }
+        java::PFloatArray array=java::FloatArray::FromRange(values);
+        TEST_CHECK_FAIL(array->GetLength()!=5000,
+            "FromRange: invalid length %d.",array->GetLength());
+        TEST_CHECK_FAIL(array->GetAt(4999)!=4999*0.5f,
+            "FromRange: invalid value %f.",array->GetAt(4999));
+
+        std::vector<double> copy;
+        array->CopyTo(copy);
+        TEST_CHECK_FAIL(copy!=values,
+            "CopyTo: values differ.");
+
+        uint16_t shorts[3]={0,1,0xFFFF};
+        java::PIntArray ints=java::IntArray::FromRange(shorts,shorts+3);
+        TEST_CHECK_FAIL(ints->GetAt(2)!=0xFFFF,
+            "FromRange: invalid widened value %d.",ints->GetAt(2));
+    }
+
+    {
+        const jsize rows=70;
+        const jsize columns=5;
+        std::vector<jint> data(rows*columns);
+        for (size_t i=0;i!=data.size();++i) {
+            data[i]=jint(i);
+        }
+        java::PIntMatrixArray matrix=java::IntMatrixArray::FromData(&data[0],rows,columns);
+        TEST_CHECK_FAIL(matrix->GetRowCount()!=rows || matrix->GetColumnCount()!=columns,
+            "Matrix: invalid size %dx%d.",matrix->GetRowCount(),matrix->GetColumnCount());
+        TEST_CHECK_FAIL(matrix->GetAt(3)->GetAt(2)!=3*columns+2,
+            "Matrix: invalid element %d.",matrix->GetAt(3)->GetAt(2));
+
+        std::vector<jint> copy(rows*columns);
+        matrix->GetData(&copy[0],columns);
+        TEST_CHECK_FAIL(copy!=data,
+            "Matrix: GetData() returned different data.");
+
+        java::PIntMatrixArray zeros=new java::IntMatrixArray(rows,columns);
+        zeros->SetData(&data[0],columns);
+        jint row[columns];
+        zeros->GetRow(rows-1,columns,row);
+        TEST_CHECK_FAIL(row[columns-1]!=rows*columns-1,
+            "Matrix: invalid last element %d.",row[columns-1]);
+
+        zeros->SetAt(rows-1,java::PIntArray());
+        try {
+            zeros->GetData(&copy[0],columns);
+            TEST_FAILED("Matrix: null row was not detected by GetData().");
+        }
+        catch (const jni::AbstractObject&) {
+        }
+        try {
+            zeros->GetRow(rows-1,columns,row);
+            TEST_FAILED("Matrix: null row was not detected by GetRow().");
+        }
+        catch (const jni::AbstractObject&) {
+        }
+    }
+
+    {
+        java::PClass intArrayClass=java::IntArray::GetTypeClass();
+        TEST_CHECK_FAIL(intArrayClass!=java::IntArray::GetTypeClass(),
+            "GetTypeClass: int[] class was resolved twice.");
+        TEST_CHECK_FAIL(strcmp(intArrayClass->GetName()->GetUTF(),"[I"),
+            "GetTypeClass: invalid int[] class %s.",intArrayClass->GetName()->GetUTF());
+        java::PClass matrixClass=java::IntMatrixArray::GetTypeClass();
+        TEST_CHECK_FAIL(strcmp(matrixClass->GetName()->GetUTF(),"[[I"),
+            "GetTypeClass: invalid int[][] class %s.",matrixClass->GetName()->GetUTF());
+        java::PClass stringArrayClass=java::StringArray::GetTypeClass();
+        TEST_CHECK_FAIL(strcmp(stringArrayClass->GetName()->GetUTF(),"[Ljava.lang.String;"),
+            "GetTypeClass: invalid String[] class %s.",stringArrayClass->GetName()->GetUTF());
+    }
+
     TEST_PASSED();
 }
@@ -46,6 +46,9 @@ JB_DEFINE_ACCESSOR(
     (StaticLong,"+staticLongField","J")
     (StaticFloat,"+staticFloatField","F")
     (StaticDouble,"+staticDoubleField","D")
+    (ConstantInt,"=CONSTANT_INT","I")
+    (ConstantBoolean,"=CONSTANT_BOOLEAN","Z")
+    (ConstantString,"=CONSTANT_STRING","Ljava/lang/String;")
     ,
     Methods
     (Constructor,"<init>","()V")
@@ -99,6 +102,160 @@ GENERATE_STATIC_FIELD_TEST(Long,LongField,jlong,"%lld");
 GENERATE_STATIC_FIELD_TEST(Float,FloatField,jfloat,"%f");
 GENERATE_STATIC_FIELD_TEST(Double,DoubleField,jdouble,"%g");
 
+static void TestConstantFields() {
+    TEST_CHECK_FAIL(JB_GET_STATIC(IntField,ConstantInt)!=0x7E57,
+        "Constant int value %d is invalid.",JB_GET_STATIC(IntField,ConstantInt));
+    TEST_CHECK_FAIL(!JB_GET_STATIC(BoolField,ConstantBoolean),
+        "Constant boolean value is invalid.");
+    java::PString string=java::PString::Wrap(JB_GET_STATIC(ObjectField,ConstantString));
+    TEST_CHECK_FAIL(!string || strcmp(string->GetUTF(),"constant"),
+        "Constant string value is invalid.");
+}
+
+static void TestFieldAccessors(const jni::LObject& object) {
+    static const jb::Field<jint> intField=JB_FIELD(jint,Int);
+    intField(object,0x0F0F0F0F);
+    TEST_CHECK_FAIL(JB_GET(IntField,object,Int)!=0x0F0F0F0F,
+        "Field<jint>: value was not set.");
+    TEST_CHECK_FAIL(intField(object)!=0x0F0F0F0F,
+        "Field<jint>: invalid value %d.",intField(object));
+
+    jb::Field<bool> boolField=JB_FIELD(bool,Boolean);
+    boolField.Set(jni::GetEnv(),object.GetJObject(),true);
+    TEST_CHECK_FAIL(!boolField.Get(object),
+        "Field<bool>: invalid value.");
+
+    jb::Field<jni::LObject> objectField=JB_FIELD(jni::LObject,Object);
+    objectField(object,object);
+    TEST_CHECK_FAIL(!jni::IsSameObject(objectField(object),object),
+        "Field<LObject>: invalid value.");
+
+    jb::StaticField<jdouble> staticField=JB_STATIC_FIELD(jdouble,StaticDouble);
+    staticField(-0.5);
+    TEST_CHECK_FAIL(JB_GET_STATIC(DoubleField,StaticDouble)!=-0.5,
+        "StaticField<jdouble>: value was not set.");
+    TEST_CHECK_FAIL(staticField.Get(jni::GetEnv())!=-0.5,
+        "StaticField<jdouble>: invalid value %g.",staticField());
+}
+
+struct FieldsStruct {
+    jni::LObject object;
+    bool boolean;
+    jbyte byteValue;
+    jchar charValue;
+    jshort shortValue;
+    jint intValue;
+    jlong longValue;
+    jfloat floatValue;
+    jdouble doubleValue;
+};
+
+JB_DEFINE_STRUCT(
+    FieldsStruct
+    ,
+    Members
+    (object,Object)
+    (boolean,Boolean)
+    (byteValue,Byte)
+    (charValue,Char)
+    (shortValue,Short)
+    (intValue,Int)
+    (longValue,Long)
+    (floatValue,Float)
+    (doubleValue,Double)
+)
+
+static void TestStruct(const jni::LObject& object) {
+    FieldsStruct value;
+    value.object=object;
+    value.boolean=true;
+    value.byteValue=0x55;
+    value.charValue='#';
+    value.shortValue=-1234;
+    value.intValue=0x12345678;
+    value.longValue=0x1122334455667788ll;
+    value.floatValue=1.5f;
+    value.doubleValue=-2.25e+50;
+    JB_WRITE_STRUCT(FieldsStruct,object,value);
+    TEST_CHECK_FAIL(JB_GET(IntField,object,Int)!=value.intValue,
+        "WriteStruct: int field was not written.");
+
+    FieldsStruct testValue;
+    JB_READ_STRUCT(FieldsStruct,object,testValue);
+    TEST_CHECK_FAIL(
+        !jni::IsSameObject(testValue.object,object) ||
+        testValue.boolean!=value.boolean ||
+        testValue.byteValue!=value.byteValue ||
+        testValue.charValue!=value.charValue ||
+        testValue.shortValue!=value.shortValue ||
+        testValue.intValue!=value.intValue ||
+        testValue.longValue!=value.longValue ||
+        testValue.floatValue!=value.floatValue ||
+        testValue.doubleValue!=value.doubleValue,
+        "ReadStruct: values don't match written ones.");
+}
+
+static void TestStructArray() {
+    const jsize length=10;
+    java::PObjectArray array=new java::ObjectArray<java::Object>(length);
+    std::vector<FieldsStruct> values(length);
+    for (jsize i=0;i!=length;++i) {
+        array->SetAt(i,java::PObject::Wrap(CreateTestObject()));
+        values[i].intValue=i*100;
+        values[i].longValue=-i;
+        values[i].boolean=(i%2)!=0;
+    }
+    JB_WRITE_STRUCTS(FieldsStruct,*array,values);
+
+    std::vector<FieldsStruct> testValues;
+    JB_READ_STRUCTS(FieldsStruct,*array,testValues);
+    TEST_CHECK_FAIL(testValues.size()!=size_t(length),
+        "ReadStructs: invalid count %d.",int(testValues.size()));
+    for (jsize i=0;i!=length;++i) {
+        TEST_CHECK_FAIL(
+            testValues[i].intValue!=values[i].intValue ||
+            testValues[i].longValue!=values[i].longValue ||
+            testValues[i].boolean!=values[i].boolean,
+            "ReadStructs: element %d doesn't match.",i);
+    }
+
+    FieldsStruct tail[2];
+    JB_READ_STRUCTS(FieldsStruct,*array,length-2,2,tail);
+    TEST_CHECK_FAIL(tail[1].intValue!=(length-1)*100,
+        "ReadStructs: range read failed.");
+
+    // Invalid ranges must be rejected before 'tail' is touched.
+    tail[0].intValue=-1;
+    try {
+        JB_READ_STRUCTS(FieldsStruct,*array,0,-1,tail);
+        TEST_FAILED("ReadStructs: negative length was not detected.");
+    }
+    catch (const jni::AbstractObject&) {
+    }
+    try {
+        JB_READ_STRUCTS(FieldsStruct,*array,length-1,2,tail);
+        TEST_FAILED("ReadStructs: range past the end was not detected.");
+    }
+    catch (const jni::AbstractObject&) {
+    }
+    TEST_CHECK_FAIL(tail[0].intValue!=-1,
+        "ReadStructs: invalid range was partially read.");
+    try {
+        JB_WRITE_STRUCTS(FieldsStruct,*array,-1,1,tail);
+        TEST_FAILED("WriteStructs: negative start was not detected.");
+    }
+    catch (const jni::AbstractObject&) {
+    }
+
+    array->SetAt(3,java::PObject());
+    try {
+        JB_READ_STRUCTS(FieldsStruct,*array,testValues);
+        TEST_FAILED("ReadStructs: null element was not detected.");
+    }
+    catch (const jni::AbstractObject&) {
+    }
+}
+
 #undef JB_CURRENT_CLASS
 
 ///////////////////////////////////////////////////////////////////// test
@@ -117,6 +274,8 @@ void RunFieldsTest() {
     TestStaticFloatField(0.0001f);
     TestStaticDoubleField(0.77e+100);
 
+    TestConstantFields();
+
     jni::LObject testObject=CreateTestObject();
 
     TestBooleanField(testObject,JNI_FALSE);
@@ -131,5 +290,9 @@ void RunFieldsTest() {
     TestFloatField(testObject,0.3434f);
     TestDoubleField(testObject,0.77e-12);
 
+    TestFieldAccessors(testObject);
+    TestStruct(testObject);
+    TestStructArray();
+
     TEST_PASSED();
 }
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+
+#define TEST_NAME "InstanceHandleTest"
+
+/////////////////////////////////////////////////////////////////////
+
+#ifdef JNIPP_NATIVE_INSTANCE_HANDLES
+
+static uint32_t GetHandleIndex(jlong handle) {
+    return uint32_t(uint64_t(handle));
+}
+
+/* Must run before live objects are created, otherwise finalizers
+ *  can free slots concurrently and change which slot gets reused.
+ */
+void RunInstanceHandleTest() {
+    java::PObject first=new java::Object();
+    java::PObject second=new java::Object();
+
+    jlong firstHandle=java::CreateInstanceHandle(first.Get());
+    jlong secondHandle=java::CreateInstanceHandle(second.Get());
+    TEST_CHECK_FAIL(!firstHandle || !secondHandle || firstHandle==secondHandle,
+        "CreateInstanceHandle returned invalid handles.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(firstHandle)!=first.Get(),
+        "ResolveInstanceHandle returned wrong object.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(secondHandle)!=second.Get(),
+        "ResolveInstanceHandle returned wrong object.");
+
+    java::DestroyInstanceHandle(firstHandle);
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(firstHandle),
+        "Destroyed handle is still resolved.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(secondHandle)!=second.Get(),
+        "DestroyInstanceHandle affected other handle.");
+
+    // Stale handle must be ignored, not freed again.
+    java::DestroyInstanceHandle(firstHandle);
+
+    jlong reusedHandle=java::CreateInstanceHandle(second.Get());
+    TEST_CHECK_FAIL(GetHandleIndex(reusedHandle)!=GetHandleIndex(firstHandle),
+        "Freed slot was not reused.");
+    TEST_CHECK_FAIL(reusedHandle==firstHandle,
+        "Reused slot has the same generation.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(firstHandle),
+        "Stale handle resolved to the new slot owner.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(reusedHandle)!=second.Get(),
+        "ResolveInstanceHandle returned wrong object for reused slot.");
+
+    jlong nextHandle=java::CreateInstanceHandle(first.Get());
+    TEST_CHECK_FAIL(GetHandleIndex(nextHandle)==GetHandleIndex(reusedHandle),
+        "Slot was freed twice.");
+
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(0),
+        "Zero handle is resolved.");
+    TEST_CHECK_FAIL(java::ResolveInstanceHandle(jlong((uint64_t(1)<<32) | 0xFFFFFFF0u)),
+        "Out of range handle is resolved.");
+
+    TEST_CHECK_FAIL(java::NextInstanceHandleGeneration(1)!=2,
+        "NextInstanceHandleGeneration(1) failed.");
+    TEST_CHECK_FAIL(java::NextInstanceHandleGeneration(0xFFFFFFFFu)!=1,
+        "Generation wrapped to 0.");
+
+    java::DestroyInstanceHandle(secondHandle);
+    java::DestroyInstanceHandle(reusedHandle);
+    java::DestroyInstanceHandle(nextHandle);
+
+    TEST_PASSED();
+}
+
+#else
+
+void RunInstanceHandleTest() {
+    TEST_PRINTF("SKIPPED: JNIPP_NATIVE_INSTANCE_HANDLES is not defined");
+}
+
+#endif // JNIPP_NATIVE_INSTANCE_HANDLES
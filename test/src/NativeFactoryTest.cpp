@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+#include "../../src/StringHashTable.h"
+#include <stdio.h>
+
+#define TEST_NAME "NativeFactoryTest"
+
+/////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char* g_lastFactory=0;
+jobject g_lastObject=0;
+
+void FirstFactory(const jni::LObject& object) {
+    g_lastFactory="first";
+    g_lastObject=object.GetJObject();
+}
+
+void SecondFactory(const jni::LObject& object) {
+    g_lastFactory="second";
+    g_lastObject=object.GetJObject();
+}
+
+void StaticFactory(const jni::LObject& object) {
+    g_lastFactory="static";
+    g_lastObject=object.GetJObject();
+}
+
+/* Registers factory before main() runs. */
+struct StaticRegistration {
+    StaticRegistration() {
+        jb::RegisterNativeFactory("test.NativeFactory$Static",&StaticFactory);
+    }
+} g_staticRegistration;
+
+}
+
+void RunNativeFactoryTest() {
+    {
+        jb::StringHashTable<int> table;
+        TEST_CHECK_FAIL(table.Find("missing"),
+            "StringHashTable: found value in empty table.");
+        char name[32];
+        // Enough values to force several rehashes.
+        for (int i=0;i!=1000;++i) {
+            sprintf(name,"value%d",i);
+            table.Insert(name)=i;
+        }
+        TEST_CHECK_FAIL(table.GetCount()!=1000,
+            "StringHashTable: invalid count %d.",int(table.GetCount()));
+        for (int i=0;i!=1000;++i) {
+            sprintf(name,"value%d",i);
+            const int* value=table.Find(name);
+            TEST_CHECK_FAIL(!value || *value!=i,
+                "StringHashTable: invalid value for '%s'.",name);
+        }
+        table.Insert("value7")=-7;
+        TEST_CHECK_FAIL(table.GetCount()!=1000 || *table.Find("value7")!=-7,
+            "StringHashTable: Insert() didn't replace value.");
+        TEST_CHECK_FAIL(table.Find("value1000"),
+            "StringHashTable: found missing value.");
+        table.Clear();
+        TEST_CHECK_FAIL(table.GetCount() || table.Find("value0"),
+            "StringHashTable: Clear() didn't remove values.");
+    }
+    {
+        java::PString string=java::PString::New("native factory");
+        jni::LObject object=jni::LObject::Wrap(string->GetJObject());
+
+        TEST_CHECK_FAIL(jb::CreateNativeInstance("test.NativeFactory$Missing",object),
+            "CreateNativeInstance succeeded for unregistered name.");
+        TEST_CHECK_FAIL(g_lastFactory,
+            "CreateNativeInstance called factory for unregistered name.");
+
+        jb::RegisterNativeFactory("test.NativeFactory",&FirstFactory);
+        TEST_CHECK_FAIL(!jb::CreateNativeInstance("test.NativeFactory",object),
+            "CreateNativeInstance failed for registered name.");
+        TEST_CHECK_FAIL(!g_lastFactory || strcmp(g_lastFactory,"first"),
+            "CreateNativeInstance called wrong factory.");
+        TEST_CHECK_FAIL(g_lastObject!=object.GetJObject(),
+            "CreateNativeInstance passed wrong object.");
+
+        jb::RegisterNativeFactory("test.NativeFactory",&SecondFactory);
+        jb::CreateNativeInstance("test.NativeFactory",object);
+        TEST_CHECK_FAIL(strcmp(g_lastFactory,"second"),
+            "RegisterNativeFactory didn't replace factory.");
+
+        TEST_CHECK_FAIL(!jb::CreateNativeInstance("test.NativeFactory$Static",object),
+            "Factory registered from static initializer is lost.");
+        TEST_CHECK_FAIL(strcmp(g_lastFactory,"static"),
+            "CreateNativeInstance called wrong factory.");
+    }
+    TEST_PASSED();
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+
+#define TEST_NAME "NioTest"
+
+/////////////////////////////////////////////////////////////////////
+
+void RunNioTest() {
+    {
+        jbyte memory[32]={0};
+        java::nio::PByteBuffer buffer=new java::nio::ByteBuffer(memory,sizeof(memory));
+        TEST_CHECK_FAIL(buffer->GetData()!=memory,
+            "Invalid address of wrapped buffer.");
+        TEST_CHECK_FAIL(buffer->GetLength()!=sizeof(memory),
+            "Invalid length %d of wrapped buffer.",(int)buffer->GetLength());
+        TEST_CHECK_FAIL(!buffer->IsDirect(),
+            "Wrapped buffer is not direct.");
+        TEST_CHECK_FAIL(buffer->GetCapacity()!=sizeof(memory),
+            "Invalid capacity %d of wrapped buffer.",buffer->GetCapacity());
+    }
+
+    {
+        java::nio::PByteBuffer buffer=java::nio::ByteBuffer::AllocateDirect(16);
+        java::nio::PIntBuffer ints=buffer->AsIntBuffer();
+        TEST_CHECK_FAIL(ints->GetLength()!=4,
+            "Invalid length %d of int view.",(int)ints->GetLength());
+        TEST_CHECK_FAIL((void*)ints->GetData()!=(void*)buffer->GetData(),
+            "Int view doesn't share memory with byte buffer.");
+        for (jint* i=ints->Begin();i!=ints->End();++i) {
+            *i=0x01020304;
+        }
+        jint value=0;
+        memcpy(&value,buffer->GetData()+12,sizeof(value));
+        TEST_CHECK_FAIL(value!=0x01020304,
+            "Invalid value %08X read through byte buffer.",value);
+    }
+
+    {
+        java::nio::PByteBuffer buffer;
+        {
+            // Map our own executable, it's always there and readable.
+            java::nio::MappedFile file("/proc/self/exe");
+            TEST_CHECK_FAIL(file.GetLength()<4 || memcmp(file.GetData(),"\x7F""ELF",4),
+                "MappedFile: invalid data.");
+            buffer=file.GetBuffer();
+            TEST_CHECK_FAIL(buffer->GetData()!=file.GetData(),
+                "MappedFile: buffer doesn't share memory with mapping.");
+            TEST_CHECK_FAIL(buffer->GetCapacity()!=(jint)file.GetLength(),
+                "MappedFile: invalid buffer capacity %d.",buffer->GetCapacity());
+            TEST_CHECK_FAIL(!jni::IsSameObject(*buffer,*file.GetBuffer()),
+                "MappedFile: buffer was created twice.");
+        }
+        // Mapping is owned by the buffer.
+        TEST_CHECK_FAIL(memcmp(buffer->GetData(),"\x7F""ELF",4),
+            "MappedFile: mapping is not accessible after MappedFile is destroyed.");
+    }
+
+    {
+        java::nio::MappedFile file("/proc/self/exe",1,3);
+        TEST_CHECK_FAIL(file.GetLength()!=3 || memcmp(file.GetData(),"ELF",3),
+            "MappedFile: invalid data at offset 1.");
+    }
+
+    {
+        java::nio::RingBuffer::RegisterNatives();
+
+        java::nio::RingBuffer producer(64);
+        java::nio::RingBuffer consumer(producer.GetBuffer());
+        TEST_CHECK_FAIL(consumer.GetCapacity()!=64,
+            "RingBuffer: invalid capacity %d.",(int)consumer.GetCapacity());
+        TEST_CHECK_FAIL(consumer.WaitReadable(0),
+            "RingBuffer: empty ring is readable.");
+
+        // Each byte is its stream position; odd chunk size makes data
+        //  wrap around the end of the ring.
+        char input[37];
+        char output[100];
+        size_t written=0;
+        size_t read=0;
+        for (int round=0;round!=10;++round) {
+            for (size_t i=0;i!=sizeof(input);++i) {
+                input[i]=char(written+i);
+            }
+            written+=producer.Write(input,sizeof(input));
+            TEST_CHECK_FAIL(!consumer.WaitReadable(0),
+                "RingBuffer: ring is not readable after write.");
+            size_t length=consumer.Read(output,sizeof(output));
+            for (size_t i=0;i!=length;++i) {
+                TEST_CHECK_FAIL(output[i]!=char(read+i),
+                    "RingBuffer: invalid byte at %d.",(int)(read+i));
+            }
+            read+=length;
+        }
+        TEST_CHECK_FAIL(read!=written,
+            "RingBuffer: read %d bytes, written %d.",(int)read,(int)written);
+
+        char large[100]={0};
+        TEST_CHECK_FAIL(producer.Write(large,sizeof(large))!=64,
+            "RingBuffer: overfilled.");
+        TEST_CHECK_FAIL(producer.WaitWritable(10),
+            "RingBuffer: full ring is writable.");
+    }
+
+    try {
+        java::nio::MappedFile file("/nonexistent/file");
+        TEST_FAILED("MappedFile: no exception for missing file.");
+    }
+    catch (const jni::AbstractObject&) {
+    }
+
+    TEST_PASSED();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+
+#define TEST_NAME "PackedTest"
+
+/////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Sample {
+    typedef java::PackedField<jint,0> Id;
+    typedef java::PackedField<jshort,4> Flags;
+    typedef java::PackedField<jlong,6> Timestamp;
+    typedef java::PackedField<jfloat,14,java::LittleEndian> Value;
+    enum { Size=18 };
+};
+
+}
+
+void RunPackedTest() {
+    {
+        // Big-endian values as written by DataOutputStream.
+        const jbyte data[]={0x01,0x02,0x03,0x04, 0x05,0x06, 0x07,0x08};
+        TEST_CHECK_FAIL(java::LoadPacked<jint>(data)!=0x01020304,
+            "LoadPacked<jint> failed.");
+        TEST_CHECK_FAIL(java::LoadPacked<jshort>(data+4)!=0x0506,
+            "LoadPacked<jshort> failed.");
+        TEST_CHECK_FAIL(java::LoadPacked<jshort>(data+6,java::LittleEndian)!=0x0807,
+            "LoadPacked<jshort> (little endian) failed.");
+    }
+    {
+        // Odd count and offset to cover both vector and scalar paths.
+        jint values[37];
+        for (size_t i=0;i!=37;++i) {
+            values[i]=jint(i*0x01010101+0x10203);
+        }
+        jbyte encoded[37*4+1];
+        java::EncodeElements(values,37,encoded+1);
+        for (size_t i=0;i!=37;++i) {
+            TEST_CHECK_FAIL(java::LoadPacked<jint>(encoded+1+i*4)!=values[i],
+                "EncodeElements: invalid value at %d.",int(i));
+        }
+        jint decoded[37];
+        java::DecodeElements(encoded+1,37,decoded);
+        TEST_CHECK_FAIL(memcmp(values,decoded,sizeof(values)),
+            "DecodeElements: values don't match.");
+    }
+    {
+        const size_t count=100;
+        java::PByteArray array=new java::ByteArray(jsize(count*Sample::Size));
+        {
+            java::PackedArrayRecords<Sample> records(*array);
+            TEST_CHECK_FAIL(records.GetCount()!=count,
+                "Invalid record count %d.",int(records.GetCount()));
+            jlong timestamps[count];
+            for (size_t i=0;i!=count;++i) {
+                records.Set<Sample::Id>(i,jint(i));
+                records.Set<Sample::Flags>(i,jshort(-1));
+                records.Set<Sample::Value>(i,i*0.5f);
+                timestamps[i]=jlong(i)<<40;
+            }
+            records.SetColumn<Sample::Timestamp>(0,count,timestamps);
+        }
+        TEST_CHECK_FAIL(array->GetAt(Sample::Size+3)!=1,
+            "Id is not big endian.");
+        {
+            java::PackedArrayRecords<Sample> records(*array);
+            jint ids[count];
+            records.GetColumn<Sample::Id>(0,count,ids);
+            jlong timestamps[count];
+            records.GetColumn<Sample::Timestamp>(0,count,timestamps);
+            for (size_t i=0;i!=count;++i) {
+                TEST_CHECK_FAIL(ids[i]!=jint(i),
+                    "GetColumn: invalid id at %d.",int(i));
+                TEST_CHECK_FAIL(timestamps[i]!=(jlong(i)<<40),
+                    "GetColumn: invalid timestamp at %d.",int(i));
+                TEST_CHECK_FAIL(records.Get<Sample::Flags>(i)!=-1,
+                    "Get: invalid flags at %d.",int(i));
+                TEST_CHECK_FAIL(records.Get<Sample::Value>(i)!=i*0.5f,
+                    "Get: invalid value at %d.",int(i));
+            }
+            records.Abort();
+        }
+    }
+    TEST_PASSED();
+}
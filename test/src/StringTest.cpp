@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Common.h"
+
+#define TEST_NAME "StringTest"
+
+///////////////////////////////////////////////////////////////////// helpers
+
+static const char TestString[]="{\"key\":[1,2,3]}";
+
+static void CheckChars(const char* what,const jchar* chars,jsize length) {
+    jsize expectedLength=jsize(strlen(TestString));
+    TEST_CHECK_FAIL(length!=expectedLength,
+        "%s: invalid length %d (expected %d).",what,length,expectedLength);
+    for (jsize i=0;i!=length;++i) {
+        TEST_CHECK_FAIL(chars[i]!=jchar(TestString[i]),
+            "%s: invalid character %04X at %d (expected %04X).",
+            what,chars[i],i,jchar(TestString[i]));
+    }
+}
+
+// "a", NUL, U+00E9, U+1F600 in standard UTF-8.
+static const char TestUTF8[]="a\0\xC3\xA9\xF0\x9F\x98\x80";
+static const jchar TestUTF16[]={'a',0,0x00E9,0xD83D,0xDE00};
+
+static void CheckUTF8() {
+    std::string utf8(TestUTF8,sizeof(TestUTF8)-1);
+    java::PString string=java::String::FromUTF8(utf8);
+    jsize length=jsize(sizeof(TestUTF16)/sizeof(jchar));
+    TEST_CHECK_FAIL(string->GetLength()!=length,
+        "FromUTF8: invalid length %d (expected %d).",string->GetLength(),length);
+    jchar chars[sizeof(TestUTF16)/sizeof(jchar)]={0};
+    string->GetRegion(0,length,chars);
+    TEST_CHECK_FAIL(memcmp(chars,TestUTF16,sizeof(TestUTF16)),
+        "FromUTF8: invalid characters.");
+    TEST_CHECK_FAIL(string->ToUTF8()!=utf8,
+        "ToUTF8: invalid result.");
+
+    // Malformed input is replaced with U+FFFD.
+    java::PString malformed=java::String::FromUTF8("\xFF",1);
+    TEST_CHECK_FAIL(malformed->GetLength()!=1 || malformed->Get()[0]!=0xFFFD,
+        "FromUTF8: malformed input is not replaced.");
+}
+
+static void CheckCachePolicy() {
+    // Long enough not to fit into inline buffers.
+    java::PString string=java::PString::New("0123456789abcdef0123456789abcdef");
+    string->SetCachePolicy(java::String::CacheLast);
+
+    size_t bytes=java::String::GetCachedBytes();
+    size_t length=strlen(string->GetUTF());
+    TEST_CHECK_FAIL(java::String::GetCachedBytes()!=bytes+length+1,
+        "GetCachedBytes: UTF copy is not accounted.");
+    string->Get();
+    TEST_CHECK_FAIL(java::String::GetCachedBytes()!=bytes+(length+1)*sizeof(jchar),
+        "CacheLast: UTF copy is not dropped.");
+    string->DropCaches();
+    TEST_CHECK_FAIL(java::String::GetCachedBytes()!=bytes,
+        "DropCaches: copies are not dropped.");
+}
+
+static const java::PString& GetInternedLiteral() {
+    return JNIPP_STRING("interned");
+}
+
+static void CheckIntern() {
+    const java::PString& string=GetInternedLiteral();
+    TEST_CHECK_FAIL(strcmp(string->GetUTF(),"interned"),
+        "Intern: invalid contents '%s'.",string->GetUTF());
+    TEST_CHECK_FAIL(&GetInternedLiteral()!=&string,
+        "Intern: literal cache gives different strings.");
+    TEST_CHECK_FAIL(JNIPP_STRING("interned")!=string,
+        "Intern: same literal gives different strings.");
+
+    // Buffer contents are copied, so reusing buffer is fine.
+    char buffer[]="interned";
+    TEST_CHECK_FAIL(java::String::Intern(buffer)!=string,
+        "Intern: same contents give different strings.");
+    buffer[0]='I';
+    const java::PString& other=java::String::Intern(buffer);
+    TEST_CHECK_FAIL(other==string || strcmp(other->GetUTF(),"Interned"),
+        "Intern: reused buffer gives invalid string '%s'.",other->GetUTF());
+    TEST_CHECK_FAIL(java::String::Intern("interned")!=string,
+        "Intern: string changed after buffer was reused.");
+}
+
+static void CheckStringArray() {
+    // More than one batch, with a null element in the middle.
+    const size_t count=100;
+    const size_t nullIndex=70;
+    std::vector<std::string> strings(count);
+    std::vector<const char*> pointers(count);
+    std::vector<size_t> lengths(count);
+    for (size_t i=0;i!=count;++i) {
+        char buffer[32];
+        sprintf(buffer,"string%d",int(i));
+        strings[i]=buffer;
+        strings[i].append(TestUTF8,sizeof(TestUTF8)-1);
+        pointers[i]=(i==nullIndex) ? 0 : strings[i].data();
+        lengths[i]=strings[i].size();
+    }
+
+    java::PStringArray array=java::NewStringArray(&pointers[0],&lengths[0],count);
+    TEST_CHECK_FAIL(array->GetLength()!=jsize(count),
+        "NewStringArray: invalid length %d.",array->GetLength());
+    TEST_CHECK_FAIL(array->GetAt(nullIndex),
+        "NewStringArray: element %d is not null.",int(nullIndex));
+    TEST_CHECK_FAIL(array->GetAt(1)->ToUTF8()!=strings[1],
+        "NewStringArray: invalid element.");
+
+    java::UTFStringArena arena;
+    java::GetStrings(*array,arena);
+    TEST_CHECK_FAIL(arena.GetCount()!=count,
+        "GetStrings: invalid count %d.",int(arena.GetCount()));
+    for (size_t i=0;i!=count;++i) {
+        if (i==nullIndex) {
+            TEST_CHECK_FAIL(arena.GetAt(i),"GetStrings: %d is not null.",int(i));
+            continue;
+        }
+        TEST_CHECK_FAIL(
+            std::string(arena.GetAt(i),arena.GetLengthAt(i))!=strings[i],
+            "GetStrings: invalid string at %d.",int(i));
+    }
+
+    java::PStringArray copy=java::NewStringArray(arena);
+    TEST_CHECK_FAIL(copy->GetLength()!=jsize(count) ||
+        copy->GetAt(99)->ToUTF8()!=strings[99],
+        "NewStringArray(arena): invalid result.");
+}
+
+///////////////////////////////////////////////////////////////////// test
+
+void RunStringTest() {
+    java::PString string=java::PString::New(TestString);
+
+    {
+        java::StringCharsView chars(string);
+        CheckChars("StringCharsView",chars.GetData(),chars.GetLength());
+    }
+    {
+        java::StringCriticalView chars(string);
+        CheckChars("StringCriticalView",chars.GetData(),chars.GetLength());
+    }
+    {
+        jchar chars[sizeof(TestString)]={0};
+        string->GetRegion(0,string->GetLength(),chars);
+        CheckChars("GetRegion",chars,string->GetLength());
+
+        char utfChars[sizeof(TestString)]={0};
+        string->GetUTFRegion(1,5,utfChars);
+        TEST_CHECK_FAIL(memcmp(utfChars,TestString+1,5),
+            "GetUTFRegion: invalid result '%.5s'.",utfChars);
+    }
+    TEST_CHECK_FAIL(strcmp(string->GetUTF(),TestString),
+        "GetUTF: invalid result '%s'.",string->GetUTF());
+    CheckChars("Get",string->Get(),string->GetLength());
+    CheckUTF8();
+    CheckCachePolicy();
+    CheckIntern();
+    CheckStringArray();
+
+    TEST_PASSED();
+}
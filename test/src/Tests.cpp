@@ -26,16 +26,28 @@ void RunFieldsTest();
 void RunLiveClassTest();
 void RunCastsTest();
 void RunArrayTest();
+void RunStringTest();
+void RunNioTest();
+void RunAlgorithmsTest();
+void RunPackedTest();
+void RunInstanceHandleTest();
+void RunNativeFactoryTest();
 
 extern "C" void Java_com_itoa_jnipp_test_Tests_run(JNIEnv* env,jclass) {
     jni::Initialize(env);
 
     try {
         RunArrayTest();
+        RunStringTest();
+        RunNioTest();
+        RunAlgorithmsTest();
+        RunPackedTest();
+        RunInstanceHandleTest();
         RunMethodTest();
         RunFieldsTest();
         RunLiveClassTest();
         RunCastsTest();
+        RunNativeFactoryTest();
 
         TEST_PRINTF("Done");
     }